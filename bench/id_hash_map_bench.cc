@@ -0,0 +1,115 @@
+// Compare IdHashMap with the flat array indexed by order id it replaced in
+// the trading order book: lookups, cancel+add churn where every new id comes
+// from a growing counter, and clearing a map whose table once grew far past
+// the orders now live in it, erasing the live ids against clearing the whole
+// table.
+#include <array>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "common/IdHashMap.hpp"
+#include "common/TimeUtil.hpp"
+
+using namespace Common;
+
+namespace {
+// Ids the replaced array could index, MATCHING_ENGINE_MAX_ORDER_IDS
+constexpr size_t ARRAY_SIZE = 1024 * 1024;
+constexpr size_t NUM_LIVE = 20000;
+constexpr size_t NUM_OPS = 10000000;
+// Initial capacity the trading book gives its map
+constexpr size_t INITIAL_SLOTS = 16 * 1024;
+
+struct Order {
+  uint64_t order_id = 0;
+};
+
+auto nsPerOp(Nanos elapsed, size_t num_ops) {
+  return static_cast<double>(elapsed) / static_cast<double>(num_ops);
+}
+}  // namespace
+
+int main(int, char**) {
+  std::mt19937_64 rng(42);
+  std::vector<Order> orders(NUM_LIVE);
+  std::vector<uint32_t> picks(NUM_OPS);
+  for (auto& pick : picks) { pick = static_cast<uint32_t>(rng() % NUM_LIVE); }
+
+  auto array = std::make_unique<std::array<Order*, ARRAY_SIZE>>();
+  IdHashMap<Order> map(INITIAL_SLOTS);
+  uint64_t next_order_id = 0;
+  for (auto& order : orders) {
+    order.order_id = next_order_id++;
+    (*array)[order.order_id] = &order;
+    map.insert(order.order_id, &order);
+  }
+
+  uint64_t checksum = 0;
+  auto start = getCurrentNanos();
+  for (const auto pick : picks) {
+    checksum += reinterpret_cast<uintptr_t>((*array)[orders[pick].order_id]);
+  }
+  const auto array_find = getCurrentNanos() - start;
+  start = getCurrentNanos();
+  for (const auto pick : picks) {
+    checksum += reinterpret_cast<uintptr_t>(map.find(orders[pick].order_id));
+  }
+  const auto map_find = getCurrentNanos() - start;
+
+  // cancel a random live order and add one with the next id, the array wraps
+  // its ids around since it cannot index past ARRAY_SIZE
+  auto array_ids = next_order_id;
+  start = getCurrentNanos();
+  for (const auto pick : picks) {
+    auto& order = orders[pick];
+    (*array)[order.order_id % ARRAY_SIZE] = nullptr;
+    order.order_id = array_ids++;
+    (*array)[order.order_id % ARRAY_SIZE] = &order;
+  }
+  const auto array_churn = getCurrentNanos() - start;
+  for (size_t i = 0; i < orders.size(); ++i) { orders[i].order_id = i; }
+  start = getCurrentNanos();
+  for (const auto pick : picks) {
+    auto& order = orders[pick];
+    map.erase(order.order_id);
+    order.order_id = next_order_id++;
+    map.insert(order.order_id, &order);
+  }
+  const auto map_churn = getCurrentNanos() - start;
+  const auto churn_capacity = map.capacity();
+
+  std::cout << "live:" << NUM_LIVE << " slots:" << churn_capacity << " checksum:" << (checksum & 0xff) << "\n"
+            << "find         ns/op array:" << nsPerOp(array_find, NUM_OPS) << " map:" << nsPerOp(map_find, NUM_OPS) << "\n"
+            << "cancel+add   ns/op array:" << nsPerOp(array_churn, NUM_OPS) << " map:" << nsPerOp(map_churn, NUM_OPS)
+            << std::endl;
+
+  // a busy session grows the table to 1M slots, later the book holds fewer orders when it is cleared
+  std::vector<Order> burst(ARRAY_SIZE / 2);
+  for (const size_t num_live : {100, 2000, 20000}) {
+    Nanos erase_elapsed = 0, clear_elapsed = 0;
+    constexpr size_t ROUNDS = 20;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+      for (const auto clear_whole : {false, true}) {
+        IdHashMap<Order> cleared(INITIAL_SLOTS);
+        for (auto& order : burst) {
+          order.order_id = next_order_id++;
+          cleared.insert(order.order_id, &order);
+        }
+        for (size_t i = num_live; i < burst.size(); ++i) { cleared.erase(burst[i].order_id); }
+        start = getCurrentNanos();
+        if (clear_whole) {
+          cleared.clear();
+        } else {
+          for (size_t i = 0; i < num_live; ++i) { cleared.erase(burst[i].order_id); }
+        }
+        (clear_whole ? clear_elapsed : erase_elapsed) += getCurrentNanos() - start;
+        checksum += cleared.size();
+      }
+    }
+    std::cout << "clear of " << num_live << " live orders us erase-live:" << nsPerOp(erase_elapsed, ROUNDS) / 1000
+              << " clear-table:" << nsPerOp(clear_elapsed, ROUNDS) / 1000 << std::endl;
+  }
+  return static_cast<int>(checksum & 0);
+}
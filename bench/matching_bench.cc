@@ -0,0 +1,85 @@
+// Time MatchingEngine::processClientRequest() per self-trade prevention mode
+// on a fixed random order flow. In the "disjoint" flow buyers and sellers are
+// different clients, so it measures the cost of the mode check on the common
+// path where no self trade happens, the "mixed" flow lets clients cross their
+// own orders.
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "matching/MatchingEngine.hpp"
+
+using namespace Exchange;
+
+namespace {
+// Requests timed per round, the logger thread drains between rounds
+constexpr size_t REQUESTS_PER_ROUND = 5000;
+constexpr size_t ROUNDS = 10;
+constexpr ClientID NUM_CLIENTS = 4;
+
+auto makeFlow(bool self_trades, size_t count) {
+  std::mt19937 rng(42);
+  std::vector<MatchingEngineClientRequest> flow;
+  std::vector<std::pair<ClientID, OrderID>> live;
+  std::array<OrderID, NUM_CLIENTS> next_order_id{};
+  flow.reserve(count);
+  while (flow.size() < count) {
+    if (live.empty() || rng() % 3) {
+      const auto side = (rng() % 2 ? Side::BUY : Side::SELL);
+      const auto client_id = static_cast<ClientID>(
+          self_trades ? rng() % NUM_CLIENTS
+                      : (side == Side::BUY ? 0 : NUM_CLIENTS / 2) + rng() % (NUM_CLIENTS / 2));
+      const auto price = 100 + (side == Side::BUY ? -1 : 1) * static_cast<Price>(rng() % 10) +
+                         static_cast<Price>(rng() % 5) - 2;
+      flow.push_back({ClientRequestType::NEW, client_id, 0, next_order_id[client_id], side, price,
+                      static_cast<Quantity>(1 + rng() % 50)});
+      live.emplace_back(client_id, next_order_id[client_id]++);
+    } else {
+      const auto index = rng() % live.size();
+      const auto [client_id, order_id] = live[index];
+      live[index] = live.back();
+      live.pop_back();
+      flow.push_back({ClientRequestType::CANCEL, client_id, 0, order_id, Side::INVALID, 0, 0});
+    }
+  }
+  return flow;
+}
+
+auto run(SelfTradePrevention self_trade_prevention, const std::vector<MatchingEngineClientRequest>& flow) {
+  ClientRequestLFQueue client_requests(1);
+  ClientResponseLFQueue client_responses(MATCHING_ENGINE_MAX_CLIENT_UPDATES);
+  MarketUpdateLFQueue market_updates(MATCHING_ENGINE_MAX_MARKET_UPDATES);
+  auto matching_engine = new MatchingEngine(&client_requests, &client_responses, &market_updates,
+                                            self_trade_prevention, 10);
+  Nanos elapsed = 0;
+  for (size_t start = 0; start < flow.size(); start += REQUESTS_PER_ROUND) {
+    const auto round_start = getCurrentNanos();
+    for (size_t i = start; i < std::min(flow.size(), start + REQUESTS_PER_ROUND); ++i) {
+      matching_engine->processClientRequest(&flow[i]);
+    }
+    elapsed += getCurrentNanos() - round_start;
+    while (client_responses.size()) { client_responses.updateReadIndex(); }
+    while (market_updates.size()) { market_updates.updateReadIndex(); }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  }
+  // every engine preallocates its pools, free them before the next mode
+  delete matching_engine;
+  return static_cast<double>(elapsed) / static_cast<double>(flow.size());
+}
+}  // namespace
+
+int main(int, char**) {
+  for (const auto self_trades : {false, true}) {
+    const auto flow = makeFlow(self_trades, REQUESTS_PER_ROUND * ROUNDS);
+    for (const auto self_trade_prevention :
+         {SelfTradePrevention::NONE, SelfTradePrevention::CANCEL_RESTING,
+          SelfTradePrevention::CANCEL_AGGRESSOR, SelfTradePrevention::DECREMENT_BOTH}) {
+      const auto ns_per_request = run(self_trade_prevention, flow);
+      std::cout << (self_trades ? "mixed    " : "disjoint ")
+                << selfTradePreventionToString(self_trade_prevention) << " ns/request:"
+                << ns_per_request << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+// Time encodeMarketUpdate() and decodeMarketUpdate() on a random order book
+// flow packed into packets the way MDPPacketWriter packs them, and compare
+// the bytes per update with the raw MDPMarketUpdate struct the wire used to
+// carry.
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "market_data/MDPCodec.hpp"
+#include "market_data/MDPPacketWriter.hpp"
+
+using namespace Exchange;
+
+namespace {
+constexpr size_t NUM_UPDATES = 1000000;
+constexpr size_t ROUNDS = 10;
+constexpr TickerID NUM_TICKERS = 8;
+// Ethernet MTU, the default of the market data channels
+constexpr size_t MTU = 1500;
+constexpr size_t MAX_PACKET_SIZE = MTU - MDP_IP_UDP_HEADER_SIZE;
+
+auto makeFlow() {
+  std::mt19937_64 rng(42);
+  std::vector<MDPMarketUpdate> flow(NUM_UPDATES);
+  std::array<size_t, NUM_TICKERS> ticker_sequence_numbers{};
+  std::vector<std::pair<TickerID, OrderID>> live;
+  OrderID next_order_id = 1;
+  for (size_t i = 0; i < flow.size(); ++i) {
+    auto& update = flow[i].me_market_update;
+    const auto ticker_id = static_cast<TickerID>(rng() % NUM_TICKERS);
+    const auto side = (rng() % 2 ? Side::BUY : Side::SELL);
+    const auto price = 100 + (side == Side::BUY ? -1 : 1) * static_cast<Price>(rng() % 10);
+    const auto quantity = static_cast<Quantity>(1 + rng() % 500);
+    const auto roll = rng() % 10;
+    if (live.empty() || roll < 5) {
+      update = {MarketUpdateType::ADD, next_order_id, ticker_id, side, price, quantity, rng() % 20};
+      live.emplace_back(ticker_id, next_order_id++);
+    } else if (roll < 8) {
+      const auto index = rng() % live.size();
+      update = {MarketUpdateType::CANCEL, live[index].second, live[index].first, side, price, 0, 0};
+      live[index] = live.back();
+      live.pop_back();
+    } else if (roll < 9) {
+      const auto& order = live[rng() % live.size()];
+      update = {MarketUpdateType::MODIFY, order.second, order.first, side, price, quantity, 0};
+    } else {
+      update = {MarketUpdateType::TRADE, ORDER_ID_INVALID, ticker_id, side, price, quantity, PRIORITY_INVALID};
+    }
+    flow[i].sequence_number = i + 1;
+    flow[i].ticker_sequence_number = ++ticker_sequence_numbers[update.ticker_id];
+  }
+  return flow;
+}
+
+// Packets are kept back to back in buffer, each led by its size, returns the
+// number of packets
+auto encode(const std::vector<MDPMarketUpdate>& flow, std::vector<char>& buffer, size_t& buffer_size) {
+  MDPCodecState state;
+  size_t num_packets = 0, packet_start = 0;
+  buffer_size = 0;
+  for (const auto& update : flow) {
+    if (!buffer_size ||
+        buffer_size - packet_start + MDP_MAX_ENCODED_UPDATE_SIZE > MAX_PACKET_SIZE) {
+      packet_start = buffer_size;
+      buffer_size += sizeof(MDPPacketHeader);
+      state.reset();
+      ++num_packets;
+    }
+    buffer_size += encodeMarketUpdate(update.me_market_update, update.ticker_sequence_number, state,
+                                      buffer.data() + buffer_size);
+  }
+  return num_packets;
+}
+
+auto decode(const std::vector<MDPMarketUpdate>& flow, const std::vector<char>& buffer,
+            size_t buffer_size, size_t& num_mismatched) {
+  MDPCodecState state;
+  MatchingEngineMarketUpdate update;
+  size_t ticker_sequence_number = 0, checksum = 0;
+  const char* next = buffer.data();
+  const char* const end = buffer.data() + buffer_size;
+  size_t packet_start = 0;
+  num_mismatched = 0;
+  for (const auto& expected : flow) {
+    const auto offset = static_cast<size_t>(next - buffer.data());
+    if (offset == 0 ||
+        offset - packet_start + MDP_MAX_ENCODED_UPDATE_SIZE > MAX_PACKET_SIZE) {
+      packet_start = offset;
+      next += sizeof(MDPPacketHeader);
+      state.reset();
+    }
+    if (!decodeMarketUpdate(next, end, state, update, ticker_sequence_number)) {
+      ++num_mismatched;
+      break;
+    }
+    const auto fields = mdpFieldMask(update.type);
+    const auto& sent = expected.me_market_update;
+    num_mismatched += (update.type != sent.type || update.side != sent.side ||
+                       ticker_sequence_number != expected.ticker_sequence_number ||
+                       ((fields & MDP_FIELD_ORDER_ID) && update.order_id != sent.order_id) ||
+                       ((fields & MDP_FIELD_PRICE) && update.price != sent.price) ||
+                       ((fields & MDP_FIELD_QUANTITY) && update.quantity != sent.quantity) ||
+                       ((fields & MDP_FIELD_PRIORITY) && update.priority != sent.priority));
+    checksum += update.order_id;
+  }
+  return checksum;
+}
+}  // namespace
+
+int main(int, char**) {
+  const auto flow = makeFlow();
+  std::vector<char> buffer(flow.size() * MDP_MAX_ENCODED_UPDATE_SIZE);
+  size_t buffer_size = 0, num_packets = 0, num_mismatched = 0, checksum = 0;
+  Nanos encode_elapsed = 0, decode_elapsed = 0;
+  for (size_t round = 0; round < ROUNDS; ++round) {
+    auto start = getCurrentNanos();
+    num_packets = encode(flow, buffer, buffer_size);
+    encode_elapsed += getCurrentNanos() - start;
+    start = getCurrentNanos();
+    checksum += decode(flow, buffer, buffer_size, num_mismatched);
+    decode_elapsed += getCurrentNanos() - start;
+  }
+
+  const auto num_updates = static_cast<double>(flow.size() * ROUNDS);
+  const auto payload_bytes = buffer_size - num_packets * sizeof(MDPPacketHeader);
+  const auto updates_per_raw_packet = (MAX_PACKET_SIZE - sizeof(MDPPacketHeader)) / sizeof(MDPMarketUpdate);
+  const auto raw_packets = (flow.size() + updates_per_raw_packet - 1) / updates_per_raw_packet;
+  std::cout << "updates:" << flow.size() << " mismatched:" << num_mismatched << " checksum:" << checksum << "\n"
+            << "encode ns/update:" << static_cast<double>(encode_elapsed) / num_updates
+            << " decode ns/update:" << static_cast<double>(decode_elapsed) / num_updates << "\n"
+            << "bytes/update compact:" << static_cast<double>(payload_bytes) / static_cast<double>(flow.size())
+            << " raw:" << sizeof(MDPMarketUpdate)
+            << " ratio:" << static_cast<double>(payload_bytes) / static_cast<double>(flow.size() * sizeof(MDPMarketUpdate)) << "\n"
+            << "packets at mtu " << MTU << " compact:" << num_packets << " raw:" << raw_packets
+            << " ratio:" << static_cast<double>(num_packets) / static_cast<double>(raw_packets) << std::endl;
+  return num_mismatched != 0;
+}
@@ -0,0 +1,162 @@
+// Time encoding and decoding of client requests and responses in the order
+// entry protocol of OrderEntryProtocol.hpp against the raw layout it
+// replaced, a size_t sequence number followed by the packed matching engine
+// struct, and compare the bytes each puts on the wire per message.
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "common/TimeUtil.hpp"
+#include "order_server/OrderEntryProtocol.hpp"
+
+using namespace Exchange;
+
+namespace {
+constexpr size_t NUM_MESSAGES = 1000000;
+constexpr size_t ROUNDS = 10;
+constexpr ClientID CLIENT_ID = 1;
+
+#pragma pack(push, 1)
+struct RawClientRequest {
+  size_t sequence_number = 0;
+  MatchingEngineClientRequest request;
+};
+
+struct RawClientResponse {
+  size_t sequence_number = 0;
+  MatchingEngineClientResponse response;
+};
+#pragma pack(pop)
+
+auto makeRequests() {
+  std::mt19937_64 rng(42);
+  std::vector<MatchingEngineClientRequest> requests(NUM_MESSAGES);
+  for (auto& request : requests) {
+    request = {ClientRequestType::NEW, CLIENT_ID, static_cast<TickerID>(rng() % 8),
+               static_cast<OrderID>(rng() % 100000), rng() % 2 ? Side::BUY : Side::SELL,
+               static_cast<Price>(100 + rng() % 20), static_cast<Quantity>(1 + rng() % 500)};
+    if (rng() % 3 == 0) {
+      request.type = ClientRequestType::CANCEL;
+      request.side = Side::INVALID;
+      request.price = PRICE_INVALID;
+      request.quantity = QUANTITY_INVALID;
+    }
+  }
+  return requests;
+}
+
+auto makeResponses() {
+  std::mt19937_64 rng(7);
+  std::vector<MatchingEngineClientResponse> responses(NUM_MESSAGES);
+  for (auto& response : responses) {
+    response = {static_cast<ClientResponseType>(1 + rng() % 3), CLIENT_ID,
+                static_cast<TickerID>(rng() % 8), static_cast<OrderID>(rng() % 100000),
+                static_cast<OrderID>(rng() % 10000000), rng() % 2 ? Side::BUY : Side::SELL,
+                static_cast<Price>(100 + rng() % 20), static_cast<Quantity>(rng() % 500),
+                static_cast<Quantity>(rng() % 500)};
+  }
+  return responses;
+}
+
+auto isSame(const MatchingEngineClientRequest& lhs, const MatchingEngineClientRequest& rhs) {
+  return !memcmp(&lhs, &rhs, sizeof(lhs));
+}
+
+auto isSame(const MatchingEngineClientResponse& lhs, const MatchingEngineClientResponse& rhs) {
+  return !memcmp(&lhs, &rhs, sizeof(lhs));
+}
+
+// Encode every message back to back into buffer, then decode them all and
+// check each against the original, ROUNDS times over
+template <typename Message, typename Encode, typename Decode>
+auto run(const char* name, const std::vector<Message>& messages, std::vector<char>& buffer,
+         Encode encode, Decode decode) {
+  size_t size = 0, num_mismatched = 0;
+  Nanos encode_elapsed = 0, decode_elapsed = 0;
+  for (size_t round = 0; round < ROUNDS; ++round) {
+    auto start = getCurrentNanos();
+    size = 0;
+    for (size_t i = 0; i < messages.size(); ++i) {
+      size += encode(static_cast<uint32_t>(i + 1), messages[i], buffer.data() + size);
+    }
+    encode_elapsed += getCurrentNanos() - start;
+
+    start = getCurrentNanos();
+    num_mismatched = 0;
+    const char* next = buffer.data();
+    for (size_t i = 0; i < messages.size(); ++i) {
+      Message decoded;
+      uint32_t sequence_number = 0;
+      next += decode(next, sequence_number, decoded);
+      num_mismatched += (sequence_number != i + 1 || !isSame(decoded, messages[i]));
+    }
+    decode_elapsed += getCurrentNanos() - start;
+  }
+  const auto num_messages = static_cast<double>(messages.size() * ROUNDS);
+  std::cout << name << " bytes/msg:" << static_cast<double>(size) / static_cast<double>(messages.size())
+            << " encode ns/msg:" << static_cast<double>(encode_elapsed) / num_messages
+            << " decode ns/msg:" << static_cast<double>(decode_elapsed) / num_messages
+            << " mismatched:" << num_mismatched << std::endl;
+  return num_mismatched;
+}
+}  // namespace
+
+int main(int, char**) {
+  const auto requests = makeRequests();
+  const auto responses = makeResponses();
+  std::vector<char> buffer(NUM_MESSAGES * std::max(ORDER_ENTRY_MAX_MESSAGE_SIZE, sizeof(RawClientResponse)));
+  size_t num_mismatched = 0;
+
+  num_mismatched += run(
+      "request  raw     ", requests, buffer,
+      [](uint32_t sequence_number, const MatchingEngineClientRequest& request, char* out) {
+        const RawClientRequest raw{sequence_number, request};
+        memcpy(out, &raw, sizeof(raw));
+        return sizeof(raw);
+      },
+      [](const char* in, uint32_t& sequence_number, MatchingEngineClientRequest& request) {
+        RawClientRequest raw;
+        memcpy(&raw, in, sizeof(raw));
+        sequence_number = static_cast<uint32_t>(raw.sequence_number);
+        request = raw.request;
+        return sizeof(raw);
+      });
+  num_mismatched += run(
+      "request  protocol", requests, buffer,
+      [](uint32_t sequence_number, const MatchingEngineClientRequest& request, char* out) {
+        return encodeClientRequest(sequence_number, request, out);
+      },
+      [](const char* in, uint32_t& sequence_number, MatchingEngineClientRequest& request) {
+        bool is_corrupt = false;
+        const auto frame_size = orderEntryFrameSize(in, ORDER_ENTRY_MAX_MESSAGE_SIZE, is_corrupt);
+        decodeClientRequest(in, CLIENT_ID, sequence_number, request);
+        return frame_size;
+      });
+  num_mismatched += run(
+      "response raw     ", responses, buffer,
+      [](uint32_t sequence_number, const MatchingEngineClientResponse& response, char* out) {
+        const RawClientResponse raw{sequence_number, response};
+        memcpy(out, &raw, sizeof(raw));
+        return sizeof(raw);
+      },
+      [](const char* in, uint32_t& sequence_number, MatchingEngineClientResponse& response) {
+        RawClientResponse raw;
+        memcpy(&raw, in, sizeof(raw));
+        sequence_number = static_cast<uint32_t>(raw.sequence_number);
+        response = raw.response;
+        return sizeof(raw);
+      });
+  num_mismatched += run(
+      "response protocol", responses, buffer,
+      [](uint32_t sequence_number, const MatchingEngineClientResponse& response, char* out) {
+        return encodeClientResponse(sequence_number, response, out);
+      },
+      [](const char* in, uint32_t& sequence_number, MatchingEngineClientResponse& response) {
+        bool is_corrupt = false;
+        const auto frame_size = orderEntryFrameSize(in, ORDER_ENTRY_MAX_MESSAGE_SIZE, is_corrupt);
+        decodeClientResponse(in, CLIENT_ID, sequence_number, response);
+        return frame_size;
+      });
+  return num_mismatched != 0;
+}
@@ -0,0 +1,75 @@
+// Stream fixed size messages from a TCPServer session to a TCPSocket client
+// over loopback, the way the order server sends responses, and report the
+// throughput. "coalesced" queues a burst of messages per loop and leaves the
+// flush to TCPServer::sendAndRecv(), one writev per loop. "per-message"
+// flushes after every message, one syscall per message.
+#include <iostream>
+
+#include "common/TCPServer.hpp"
+
+using namespace Common;
+
+namespace {
+constexpr int PORT = 19090;
+// Messages queued per loop, about what the order server drains per pass
+constexpr size_t BURST = 64;
+constexpr size_t BYTES_PER_RUN = 64 * 1024 * 1024;
+constexpr size_t SESSION_SEND_BUFFER_SIZE = 1024 * 1024;
+constexpr size_t SESSION_RECV_BUFFER_SIZE = 64 * 1024;
+}  // namespace
+
+int main(int, char**) {
+  Logger logger("tcp_loopback_bench.log");
+  TCPServer server(logger, 1, SESSION_SEND_BUFFER_SIZE, SESSION_RECV_BUFFER_SIZE);
+  TCPSocket* session = nullptr;
+  server.recv_callback = [&session](TCPSocket* socket, Nanos) {
+    session = socket;
+    socket->next_recv_read_index = socket->next_recv_valid_index;
+  };
+  server.recv_finished_callback = []() {};
+  server.listen("lo", PORT);
+
+  TCPSocket client(logger);
+  size_t received = 0;
+  client.recv_callback = [&received](TCPSocket* socket, Nanos) {
+    received += socket->next_recv_valid_index - socket->next_recv_read_index;
+    socket->next_recv_read_index = socket->next_recv_valid_index;
+  };
+  ASSERT(client.connect("127.0.0.1", "lo", PORT, false) >= 0, "Unable to connect to the bench server");
+  client.send("x", 1);
+  while (!session) {
+    server.poll();
+    server.sendAndRecv();
+    client.sendAndRecv();
+  }
+
+  char message[256] = {};
+  for (const auto flush_each : {false, true}) {
+    for (const size_t message_size : {16, 40, 256}) {
+      const auto num_messages = BYTES_PER_RUN / message_size;
+      size_t queued = 0, loops = 0, num_full = 0;
+      received = 0;
+      const auto start = getCurrentNanos();
+      while (received < num_messages * message_size) {
+        for (size_t i = 0; i < BURST && queued < num_messages; ++i) {
+          if (!session->send(message, message_size)) {
+            ++num_full;
+            break;
+          }
+          ++queued;
+          if (flush_each) { session->flush(); }
+        }
+        server.poll();
+        server.sendAndRecv();
+        client.sendAndRecv();
+        ++loops;
+      }
+      const auto seconds = static_cast<double>(getCurrentNanos() - start) / NANOS_TO_SECS;
+      std::cout << (flush_each ? "per-message " : "coalesced   ") << "size:" << message_size
+                << " msgs/s:" << static_cast<double>(num_messages) / seconds
+                << " MB/s:" << static_cast<double>(num_messages * message_size) / seconds / (1024 * 1024)
+                << " loops:" << loops << " send-buffer-full:" << num_full << std::endl;
+    }
+  }
+  return 0;
+}
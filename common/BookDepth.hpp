@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <limits>
+#include <sstream>
+
+#include "common/SeqLock.hpp"
+#include "common/Types.hpp"
+
+namespace Common {
+// Levels per side kept in a BookDepth
+constexpr size_t BOOK_DEPTH_LEVELS = 5;
+
+struct BookDepthLevel {
+  Price price = PRICE_INVALID;
+  Quantity quantity = 0;
+  uint32_t num_orders = 0;
+};
+
+// Best levels of one book, bids and asks best first. Levels past
+// num_levels[side] are stale and must be ignored.
+struct BookDepth {
+  TickerID ticker_id = TICKER_ID_INVALID;
+  std::array<uint32_t, sideToIndex(Side::MAX)> num_levels{};
+  std::array<std::array<BookDepthLevel, BOOK_DEPTH_LEVELS>, sideToIndex(Side::MAX)> levels;
+
+  // Derived from the levels by updateDerived(), NaN while a side is empty.
+  // microprice is the mid of the best levels weighted towards the side with
+  // less quantity, imbalance is (bid - ask) / (bid + ask) of the quantity on
+  // all the levels above, from -1 all asks to 1 all bids.
+  double microprice = std::numeric_limits<double>::quiet_NaN();
+  double imbalance = std::numeric_limits<double>::quiet_NaN();
+
+  auto bids() const noexcept { return &levels[sideToIndex(Side::BUY)]; }
+  auto asks() const noexcept { return &levels[sideToIndex(Side::SELL)]; }
+
+  auto numBids() const noexcept { return num_levels[sideToIndex(Side::BUY)]; }
+  auto numAsks() const noexcept { return num_levels[sideToIndex(Side::SELL)]; }
+
+  // Call after rewriting the levels of either side
+  auto updateDerived() noexcept -> void {
+    if (UNLIKELY(!numBids() || !numAsks())) {
+      microprice = imbalance = std::numeric_limits<double>::quiet_NaN();
+      return;
+    }
+    const auto& best_bid = (*bids())[0];
+    const auto& best_ask = (*asks())[0];
+    microprice = (static_cast<double>(best_bid.price) * best_ask.quantity +
+                  static_cast<double>(best_ask.price) * best_bid.quantity) /
+                 (static_cast<double>(best_bid.quantity) + best_ask.quantity);
+    double bid_quantity = 0, ask_quantity = 0;
+    for (size_t i = 0; i < numBids(); ++i) { bid_quantity += (*bids())[i].quantity; }
+    for (size_t i = 0; i < numAsks(); ++i) { ask_quantity += (*asks())[i].quantity; }
+    imbalance = (bid_quantity - ask_quantity) / (bid_quantity + ask_quantity);
+  }
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "BookDepth[ticker:" << tickerIdToString(ticker_id);
+    for (const auto side : {Side::BUY, Side::SELL}) {
+      ss << " " << sideToString(side) << ":";
+      for (size_t i = 0; i < num_levels[sideToIndex(side)]; ++i) {
+        const auto& level = levels[sideToIndex(side)][i];
+        ss << (i ? "," : "") << quantityToString(level.quantity) << "@"
+           << priceToString(level.price) << "(" << level.num_orders << ")";
+      }
+    }
+    ss << " micro:" << microprice << " imbalance:" << imbalance << "]";
+    return ss.str();
+  }
+};
+
+// Written by the thread owning a book, read by any other without locking it
+typedef SeqLock<BookDepth> BookDepthView;
+}  // namespace Common
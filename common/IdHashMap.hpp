@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/Macros.hpp"
+
+namespace Common {
+// Open addressing map from 64 bit ids to T*, for ids handed out by a counter
+// that keeps growing, so any id is accepted and memory follows the number of
+// live entries instead of the largest id. Slots are probed linearly from a
+// multiplicative hash of the id and erase shifts later entries back instead of
+// leaving tombstones. The table doubles once half full, reserve enough
+// capacity up front to keep that allocation off the hot path.
+template<typename T>
+class IdHashMap final {
+public:
+  explicit IdHashMap(std::size_t capacity_) : slots(capacity_) {
+    ASSERT(capacity_ >= 64 && !(capacity_ & (capacity_ - 1)),
+           "IdHashMap capacity must be a power of two of at least 64, got : " +
+               std::to_string(capacity_));
+    updateShift();
+  }
+
+  IdHashMap() = delete;
+  IdHashMap(const IdHashMap&) = delete;
+  IdHashMap(const IdHashMap&&) = delete;
+  IdHashMap& operator=(const IdHashMap&) = delete;
+  IdHashMap& operator=(const IdHashMap&&) = delete;
+
+  // nullptr if id is not in the map
+  auto find(uint64_t id) const noexcept -> T* {
+    for (auto index = home(id);; index = next(index)) {
+      const auto& slot = slots[index];
+      if (!slot.value || slot.id == id) { return slot.value; }
+    }
+  }
+
+  // Map id to value, replacing any previous value of id. value must not be
+  // nullptr, it marks empty slots.
+  auto insert(uint64_t id, T* value) noexcept -> void {
+    if (UNLIKELY(2 * (num_elements + 1) > slots.size())) { grow(); }
+    auto index = home(id);
+    for (; slots[index].value && slots[index].id != id; index = next(index)) {}
+    num_elements += !slots[index].value;
+    slots[index] = {id, value};
+  }
+
+  // Returns false if id was not in the map
+  auto erase(uint64_t id) noexcept -> bool {
+    auto index = home(id);
+    for (; slots[index].value && slots[index].id != id; index = next(index)) {}
+    if (!slots[index].value) { return false; }
+    // move back every later entry of the run whose home is not after the hole,
+    // so lookups never stop early at the freed slot
+    for (auto later = next(index); slots[later].value; later = next(later)) {
+      const auto later_home = home(slots[later].id);
+      if (((later - later_home) & mask()) >= ((later - index) & mask())) {
+        slots[index] = slots[later];
+        index = later;
+      }
+    }
+    slots[index] = {};
+    --num_elements;
+    return true;
+  }
+
+  // O(capacity()) and the table never shrinks, erase the live ids instead when
+  // they are known and far fewer than the slots
+  auto clear() noexcept -> void {
+    std::fill(slots.begin(), slots.end(), Slot{});
+    num_elements = 0;
+  }
+
+  auto size() const noexcept { return num_elements; }
+
+  auto capacity() const noexcept { return slots.size(); }
+
+private:
+  struct Slot {
+    uint64_t id = 0;
+    T* value = nullptr;
+  };
+
+  auto mask() const noexcept { return slots.size() - 1; }
+
+  auto next(std::size_t index) const noexcept { return (index + 1) & mask(); }
+
+  // Fibonacci hashing, consecutive ids land far apart
+  auto home(uint64_t id) const noexcept -> std::size_t {
+    return (id * 11400714819323198485ull) >> shift;
+  }
+
+  auto updateShift() noexcept -> void {
+    shift = 64;
+    for (auto capacity_ = slots.size(); capacity_ > 1; capacity_ >>= 1) { --shift; }
+  }
+
+  auto grow() noexcept -> void {
+    std::vector<Slot> old_slots(slots.size() * 2);
+    old_slots.swap(slots);
+    updateShift();
+    num_elements = 0;
+    for (const auto& slot : old_slots) {
+      if (slot.value) { insert(slot.id, slot.value); }
+    }
+  }
+
+  std::vector<Slot> slots;
+  std::size_t num_elements = 0;
+  unsigned shift = 0;
+};
+}  // namespace Common
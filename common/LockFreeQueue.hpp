@@ -39,6 +39,8 @@ public:
 
   auto size() const noexcept { return num_elements.load(); }
 
+  auto capacity() const noexcept { return store.size(); }
+
 private:
   std::vector<T> store;
   std::atomic<size_t> next_write_index = {0};
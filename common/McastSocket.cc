@@ -18,28 +18,107 @@ namespace Common {
   } 
 
   auto McastSocket::sendAndRecv() noexcept -> bool { 
-    const ssize_t n_recv = recv(socket_fd, recv_buffer.data() + next_recv_valid_index, MULTICAST_BUFFER_SIZE - next_recv_valid_index, MSG_DONTWAIT); 
+    const ssize_t n_recv = recvBatch(); 
     if(n_recv > 0) { 
-      next_recv_valid_index += n_recv; 
       logger.log("%:% %() % read socket:% len:%\n", 
         __FILE__, __LINE__, __FUNCTION__, 
         Common::getCurrentTimeStr(&time_str), socket_fd, next_recv_valid_index);
       recv_callback(this); 
     }   
     if(next_send_valid_index > 0) { 
-      ssize_t n_send = ::send(socket_fd, send_buffer.data(), next_send_valid_index, MSG_DONTWAIT | MSG_NOSIGNAL); 
-      logger.log("%:% %() % send socket:% len:%\n", 
-        __FILE__, __LINE__, __FUNCTION__, 
-        Common::getCurrentTimeStr(&time_str), socket_fd, n_send);
-      next_send_valid_index = 0;    
+      sendBatch(); 
     }
     return (n_recv > 0); 
   }
 
   auto McastSocket::send(const void *data, size_t len) noexcept -> void { 
+   if(next_send_valid_index - packet_start_index + len > MULTICAST_MAX_PACKET_SIZE) { 
+    closePacket(); 
+   }
    memcpy(send_buffer.data() + next_send_valid_index, data, len); 
    next_send_valid_index += len; 
    ASSERT(next_send_valid_index < MULTICAST_BUFFER_SIZE, 
       "Mcast socket buffer filled up and sendAndRecv() not called. "); 
   }
-}
\ No newline at end of file
+
+  auto McastSocket::sendPacket(const void *data, size_t len) noexcept -> void { 
+   ASSERT(len <= MULTICAST_MAX_PACKET_SIZE, "Packet of " + std::to_string(len) + " bytes exceeds the MTU."); 
+   closePacket(); 
+   memcpy(send_buffer.data() + next_send_valid_index, data, len); 
+   next_send_valid_index += len; 
+   closePacket(); 
+   ASSERT(next_send_valid_index < MULTICAST_BUFFER_SIZE, 
+      "Mcast socket buffer filled up and sendAndRecv() not called. "); 
+  }
+
+  auto McastSocket::closePacket() noexcept -> void { 
+   if(next_send_valid_index > packet_start_index) { 
+    send_packet_ends.push_back(next_send_valid_index); 
+    packet_start_index = next_send_valid_index; 
+   }
+  }
+
+  // Read up to a batch of datagrams into fixed size slots past the valid data, then pack them
+  // down so the buffer holds one contiguous stream of messages
+  auto McastSocket::recvBatch() noexcept -> ssize_t { 
+    const auto num_slots = std::min(MULTICAST_MAX_BATCH_PACKETS, 
+      (recv_buffer.size() - next_recv_valid_index) / MULTICAST_MAX_PACKET_SIZE); 
+    for(size_t i = 0; i < num_slots; i++) { 
+      iovs[i] = {recv_buffer.data() + next_recv_valid_index + i * MULTICAST_MAX_PACKET_SIZE, MULTICAST_MAX_PACKET_SIZE}; 
+      msgs[i] = {}; 
+      msgs[i].msg_hdr.msg_iov = &iovs[i]; 
+      msgs[i].msg_hdr.msg_iovlen = 1; 
+    }
+    const int n_packets = recvmmsg(socket_fd, msgs.data(), static_cast<unsigned int>(num_slots), MSG_DONTWAIT, nullptr); 
+    if(n_packets <= 0) { 
+      return -1; 
+    }
+    const auto recv_start = next_recv_valid_index; 
+    for(int i = 0; i < n_packets; i++) { 
+      const auto packet = static_cast<const char *>(iovs[i].iov_base); 
+      if(packet != recv_buffer.data() + next_recv_valid_index) { 
+        memmove(recv_buffer.data() + next_recv_valid_index, packet, msgs[i].msg_len); 
+      }
+      next_recv_valid_index += msgs[i].msg_len; 
+    }
+    return static_cast<ssize_t>(next_recv_valid_index - recv_start); 
+  }
+
+  // Send every queued packet, a batch per sendmmsg(). Packets the kernel has no room for stay
+  // queued for the next call.
+  auto McastSocket::sendBatch() noexcept -> void { 
+    closePacket(); 
+    while(next_send_packet < send_packet_ends.size()) { 
+      const auto num_packets = std::min(MULTICAST_MAX_BATCH_PACKETS, send_packet_ends.size() - next_send_packet); 
+      for(size_t i = 0; i < num_packets; i++) { 
+        const auto packet = next_send_packet + i; 
+        const auto start = packet ? send_packet_ends[packet - 1] : 0; 
+        iovs[i] = {send_buffer.data() + start, send_packet_ends[packet] - start}; 
+        msgs[i] = {}; 
+        msgs[i].msg_hdr.msg_iov = &iovs[i]; 
+        msgs[i].msg_hdr.msg_iovlen = 1; 
+      }
+      const int n_sent = sendmmsg(socket_fd, msgs.data(), static_cast<unsigned int>(num_packets), MSG_DONTWAIT | MSG_NOSIGNAL); 
+      logger.log("%:% %() % send socket:% packets:% sent:%\n", 
+        __FILE__, __LINE__, __FUNCTION__, 
+        Common::getCurrentTimeStr(&time_str), socket_fd, num_packets, n_sent);
+      if(n_sent < 0) { 
+        // a datagram goes out whole or not at all, keep it queued while the kernel has no room 
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR) { 
+          return; 
+        }
+        logger.log("%:% %() % send socket:% error:% dropped packet:%\n", 
+          __FILE__, __LINE__, __FUNCTION__, 
+          Common::getCurrentTimeStr(&time_str), socket_fd, std::strerror(errno), next_send_packet);
+        ++next_send_packet; 
+        continue; 
+      }
+      next_send_packet += n_sent; 
+      if(static_cast<size_t>(n_sent) < num_packets) { 
+        return; 
+      }
+    }
+    next_send_valid_index = packet_start_index = next_send_packet = 0; 
+    send_packet_ends.clear(); 
+  }
+}
@@ -1,16 +1,22 @@
 #pragma once 
 
+#include <array>
 #include <functional>
 #include "SocketUtil.hpp"
 #include "Logging.hpp"
 
 namespace Common { 
  constexpr size_t MULTICAST_BUFFER_SIZE = 64 * 1024 * 1024;
+ // Largest UDP payload that fits a 1500 byte Ethernet MTU without IP fragmentation
+ constexpr size_t MULTICAST_MAX_PACKET_SIZE = 1500 - 20 - 8;
+ // Datagrams handed to the kernel per sendmmsg() / recvmmsg() call
+ constexpr size_t MULTICAST_MAX_BATCH_PACKETS = 64;
  
  struct McastSocket { 
   McastSocket(Logger &logger_) : logger(logger_) { 
    recv_buffer.resize(MULTICAST_BUFFER_SIZE); 
    send_buffer.resize(MULTICAST_BUFFER_SIZE); 
+   send_packet_ends.reserve(MULTICAST_BUFFER_SIZE / MULTICAST_MAX_PACKET_SIZE + 1); 
   }
 
   auto init(const std::string &ip, const std::string &iface, int port, bool listening) -> int; 
@@ -19,13 +25,30 @@ namespace Common {
 
   auto leave(const std::string &ip, int port) -> void; 
 
+  // Send queued packets and read whatever datagrams are available, a batch of each per syscall
   auto sendAndRecv() noexcept -> bool; 
 
+  // Queue a message, messages are packed into MTU sized packets and never split across two
   auto send(const void *data, size_t len) noexcept -> void; 
 
+  // Queue a ready made packet as a datagram of its own
+  auto sendPacket(const void *data, size_t len) noexcept -> void; 
+
+  // Packets queued and not yet sent, counting the one still being filled
+  auto pendingPackets() const noexcept { 
+   return send_packet_ends.size() - next_send_packet + (next_send_valid_index > packet_start_index); 
+  }
+
   int socket_fd = -1; 
   
+  // Queued packets are stored back to back in send_buffer, send_packet_ends holds where each
+  // closed packet ends and the packet being filled starts at packet_start_index
   size_t next_send_valid_index = 0; 
+  size_t packet_start_index = 0; 
+  size_t next_send_packet = 0; 
+  std::vector<size_t> send_packet_ends; 
+
+  // Datagrams read in one batch are packed back to back so consumers see a plain byte stream
   size_t next_recv_valid_index = 0; 
   std::vector<char> recv_buffer; 
   std::vector<char> send_buffer; 
@@ -34,5 +57,13 @@ namespace Common {
 
   std::string time_str; 
   Logger &logger; 
+
+  private: 
+  auto closePacket() noexcept -> void; 
+  auto recvBatch() noexcept -> ssize_t; 
+  auto sendBatch() noexcept -> void; 
+
+  std::array<mmsghdr, MULTICAST_MAX_BATCH_PACKETS> msgs; 
+  std::array<iovec, MULTICAST_MAX_BATCH_PACKETS> iovs; 
  }; 
-}
\ No newline at end of file
+}
@@ -9,7 +9,7 @@ namespace Common {
 template<typename T>
 class MemPool final {
 public:
-  explicit MemPool(std::size_t num_elems) : store_(num_elems, {T(), true}) {
+  explicit MemPool(std::size_t num_elems) : store_(num_elems, {T(), 0}) {
     // std::cout << (reinterpret_cast<const ObjectBlock *> (&(store_[0].object))
     // == &(store_[0])) <<
     // '\n';
@@ -26,13 +26,13 @@ public:
   template<typename... Args>
   T* allocate(Args... args) noexcept {
     auto object_block = &(store_[next_free_index_]);
-    ASSERT(object_block->is_free, "Expected free block at index : " +
+    ASSERT(isFree(*object_block), "Expected free block at index : " +
                                       std::to_string(next_free_index_));
     T* ret = &(object_block->object);
     ret = new (ret)
         T(args...);  // Construct of new object of type T on the memory address
                      // of the current one (overwrite it)
-    object_block->is_free = false;
+    object_block->generation = generation_;
     updateNextFreeIndex();
     return ret;
   }
@@ -42,16 +42,34 @@ public:
         (reinterpret_cast<const ObjectBlock*>(elem) - &store_[0]);
     ASSERT(elem_index >= 0 && static_cast<size_t>(elem_index) < store_.size(),
            "Element being deallocated does not belong to this memory pool. ");
-    ASSERT(!store_[elem_index].is_free,
+    ASSERT(!isFree(store_[elem_index]),
            "Expected in use Object block at index : " +
                std::to_string(elem_index));
-    store_[elem_index].is_free = true;
+    store_[elem_index].generation = 0;
+  }
+
+  // Frees every element at once without touching the store, pointers into
+  // the pool from before the reset must not be used or deallocated after it
+  auto reset() noexcept {
+    ++generation_;
+    next_free_index_ = 0;
   }
 
 private:
+  struct ObjectBlock {
+    T object;
+    // generation_ of the pool when allocated, 0 once deallocated, so a reset
+    // frees every block by moving generation_ on
+    size_t generation = 0;
+  };
+
+  auto isFree(const ObjectBlock& object_block) const noexcept {
+    return object_block.generation != generation_;
+  }
+
   auto updateNextFreeIndex() noexcept {
     const auto initial_free_index = next_free_index_;
-    while (!store_[next_free_index_].is_free) {
+    while (!isFree(store_[next_free_index_])) {
       ++next_free_index_;
       if (UNLIKELY(next_free_index_ == store_.size())) {
         next_free_index_ = 0;  // Unlikely to happen
@@ -63,11 +81,8 @@ private:
     }
   }
 
-  struct ObjectBlock {
-    T object;
-    bool is_free = true;
-  };
   std::vector<ObjectBlock> store_;
   size_t next_free_index_ = 0;
+  size_t generation_ = 1;
 };
 };  // namespace Common
\ No newline at end of file
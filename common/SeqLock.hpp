@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <type_traits>
+
+#include "common/Macros.hpp"
+
+namespace Common {
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Single writer, many reader value. The writer never waits, readers retry
+// while a write is in progress or lands during their copy, so a read costs
+// one copy of T and never blocks the writer. T has to be trivially copyable
+// since readers may copy it while it is being written.
+template<typename T>
+class alignas(CACHE_LINE_SIZE) SeqLock final {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SeqLock value must be trivially copyable");
+
+public:
+  SeqLock() = default;
+  SeqLock(const SeqLock&) = delete;
+  SeqLock(const SeqLock&&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&&) = delete;
+
+  // Writer only, modify the value in place through writer(T&)
+  template<typename F>
+  auto write(F&& writer) noexcept -> void {
+    const auto sequence_number = sequence.load(std::memory_order_relaxed);
+    sequence.store(sequence_number + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    writer(value);
+    sequence.store(sequence_number + 2, std::memory_order_release);
+  }
+
+  auto store(const T& value_) noexcept -> void {
+    write([&value_](T& current) { current = value_; });
+  }
+
+  auto load() const noexcept -> T {
+    T copy;
+    std::size_t before, after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      copy = value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while (UNLIKELY(before != after || (before & 1)));
+    return copy;
+  }
+
+  // Number of completed writes, lets a reader skip a load() when nothing
+  // changed since its last one
+  auto version() const noexcept {
+    return sequence.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  std::atomic<std::size_t> sequence = 0;
+  T value{};
+};
+}  // namespace Common
@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/Macros.hpp"
+
+namespace Common {
+// Window of capacity consecutive sequence numbers starting at
+// firstSequenceNumber(), element n lives in slot n % capacity and a bitmap
+// records which slots hold a received element. Inserts, lookups and tracking
+// the first missing sequence number are O(1) amortized and never allocate.
+template<typename T>
+class SequenceRing final {
+public:
+  explicit SequenceRing(std::size_t capacity_)
+      : store(capacity_, T()), received((capacity_ + 63) / 64, 0) {
+    ASSERT(capacity_ >= 64 && !(capacity_ & (capacity_ - 1)),
+           "SequenceRing capacity must be a power of two of at least 64, got : " +
+               std::to_string(capacity_));
+  }
+
+  SequenceRing() = delete;
+  SequenceRing(const SequenceRing&) = delete;
+  SequenceRing(const SequenceRing&&) = delete;
+  SequenceRing& operator=(const SequenceRing&) = delete;
+  SequenceRing& operator=(const SequenceRing&&) = delete;
+
+  // Store element under sequence_number, returns false if it falls outside the
+  // window. A sequence number already received is overwritten.
+  auto insert(std::size_t sequence_number, const T& element) noexcept -> bool {
+    if (UNLIKELY(sequence_number < first_sequence_number ||
+                 sequence_number - first_sequence_number >= store.size())) {
+      return false;
+    }
+    store[slot(sequence_number)] = element;
+    if (contains(sequence_number)) { return true; }
+    if (empty() || sequence_number > last_sequence_number) {
+      last_sequence_number = sequence_number;
+    }
+    received[slot(sequence_number) / 64] |= bit(sequence_number);
+    ++num_elements;
+    while (next_missing <= last_sequence_number && contains(next_missing)) {
+      ++next_missing;
+    }
+    return true;
+  }
+
+  auto contains(std::size_t sequence_number) const noexcept -> bool {
+    return sequence_number >= first_sequence_number &&
+           sequence_number - first_sequence_number < store.size() &&
+           (received[slot(sequence_number) / 64] & bit(sequence_number));
+  }
+
+  auto at(std::size_t sequence_number) const noexcept -> const T& {
+    return store[slot(sequence_number)];
+  }
+
+  // Drop everything before sequence_number and move the window to start there
+  auto advanceTo(std::size_t sequence_number) noexcept -> void {
+    if (sequence_number <= first_sequence_number) { return; }
+    if (empty() || sequence_number > last_sequence_number) {
+      reset(sequence_number);
+      return;
+    }
+    for (auto n = first_sequence_number; n < sequence_number; ++n) {
+      if (received[slot(n) / 64] & bit(n)) {
+        received[slot(n) / 64] &= ~bit(n);
+        --num_elements;
+      }
+    }
+    first_sequence_number = sequence_number;
+    next_missing = std::max(next_missing, first_sequence_number);
+    while (next_missing <= last_sequence_number && contains(next_missing)) {
+      ++next_missing;
+    }
+  }
+
+  // Drop everything and start the window at first_sequence_number_
+  auto reset(std::size_t first_sequence_number_) noexcept -> void {
+    if (!empty()) {
+      for (auto n = first_sequence_number; n <= last_sequence_number; n += 64) {
+        received[slot(n) / 64] = 0;
+      }
+      received[slot(last_sequence_number) / 64] = 0;
+    }
+    first_sequence_number = next_missing = first_sequence_number_;
+    last_sequence_number = 0;
+    num_elements = 0;
+  }
+
+  // Every sequence number from firstSequenceNumber() up to nextMissing() - 1
+  // has been received
+  auto nextMissing() const noexcept { return next_missing; }
+
+  auto firstSequenceNumber() const noexcept { return first_sequence_number; }
+
+  // Highest sequence number received, only meaningful while !empty()
+  auto lastSequenceNumber() const noexcept { return last_sequence_number; }
+
+  auto empty() const noexcept { return num_elements == 0; }
+
+  auto size() const noexcept { return num_elements; }
+
+  auto capacity() const noexcept { return store.size(); }
+
+private:
+  auto slot(std::size_t sequence_number) const noexcept {
+    return sequence_number & (store.size() - 1);
+  }
+
+  static auto bit(std::size_t sequence_number) noexcept -> uint64_t {
+    return uint64_t{1} << (sequence_number & 63);
+  }
+
+  std::vector<T> store;
+  std::vector<uint64_t> received;
+  std::size_t first_sequence_number = 0;
+  std::size_t last_sequence_number = 0;
+  std::size_t next_missing = 0;
+  std::size_t num_elements = 0;
+};
+}  // namespace Common
@@ -19,9 +19,12 @@ auto TCPServer::listen(const std::string& iface, int port) -> void {
 // Check for new connections or dead connections and update containers that
 // track sockets
 auto TCPServer::poll() noexcept -> void {
-  const size_t max_events = 1 + send_sockets.size() + receive_sockets.size();
-  const int n = epoll_wait(epoll_fd, events, static_cast<int>(max_events), 0);
+  removeDeadSockets();
+  // Level triggered, a socket left with unread data is reported again on the
+  // next poll so every connection gets one read per loop
+  const int n = epoll_wait(epoll_fd, events, static_cast<int>(std::size(events)), 0);
   bool have_new_connection = false;
+  receive_sockets.clear();
   for (int i = 0; i < n; i++) {
     const auto& event = events[i];
     auto socket = reinterpret_cast<TCPSocket*>(event.data.ptr);
@@ -37,28 +40,21 @@ auto TCPServer::poll() noexcept -> void {
       logger.log("%:% %() % EPOLLIN socket:%\n", __FILE__, __LINE__,
                  __FUNCTION__, Common::getCurrentTimeStr(&time_str),
                  socket->socket_fd);
-      if (std::find(receive_sockets.begin(), receive_sockets.end(), socket) ==
-          receive_sockets.end()) {
-        receive_sockets.push_back(socket);
-      }
+      receive_sockets.push_back(socket);
     }
-    if (event.events & EPOLLOUT) {
+    if ((event.events & EPOLLOUT) && socket->is_send_blocked) {
       logger.log("%:% %() % EPOLLOUT socket:%\n", __FILE__, __LINE__,
                  __FUNCTION__, Common::getCurrentTimeStr(&time_str),
                  socket->socket_fd);
-      if (std::find(send_sockets.begin(), send_sockets.end(), socket) ==
-          send_sockets.end()) {
-        send_sockets.push_back(socket);
-      }
+      setSendBlocked(socket, false);
     }
-    if (event.events & (EPOLLHUP | EPOLLERR)) {
+    if (event.events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
       logger.log("%:% %() % EPOLLERR socket:%\n", __FILE__, __LINE__,
                  __FUNCTION__, Common::getCurrentTimeStr(&time_str),
                  socket->socket_fd);
-      if (std::find(receive_sockets.begin(), receive_sockets.end(), socket) ==
-          receive_sockets.end()) {
-        receive_sockets.push_back(socket);
-      }
+      // any data still buffered is read this loop before the socket is freed
+      if (!(event.events & EPOLLIN)) { receive_sockets.push_back(socket); }
+      markDead(socket);
     }
   }
   while (have_new_connection) {
@@ -76,33 +72,92 @@ auto TCPServer::poll() noexcept -> void {
     logger.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__,
                __FUNCTION__, Common::getCurrentTimeStr(&time_str), fd);
 
-    auto socket = new TCPSocket(logger);
+    if (UNLIKELY(free_sessions.empty())) {
+      logger.log("%:% %() % no free session, closing socket:%\n", __FILE__,
+                 __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+                 fd);
+      close(fd);
+      continue;
+    }
+    auto socket = free_sessions.back();
+    free_sessions.pop_back();
     socket->socket_fd = fd;
     socket->recv_callback = recv_callback;
+    socket->send_pending_callback = [this](auto s) { markSendPending(s); };
     ASSERT(
         addToEpollList(socket) == EXIT_SUCCESS,
         "Unable to add socket. error : " + std::string(std::strerror(errno)));
-    if (std::find(receive_sockets.begin(), receive_sockets.end(), socket) ==
-        receive_sockets.end()) {
-      receive_sockets.push_back(socket);
-    }
+    receive_sockets.push_back(socket);
   }
 }
 
 // Publish outgoing data from the send buffer and read incoming data from
-// receive buffer
+// receive buffer, only sockets with pending input or output are touched
 auto TCPServer::sendAndRecv() noexcept -> void {
   auto recv = false;
   std::for_each(receive_sockets.begin(), receive_sockets.end(),
-                [&recv](auto socket) { recv |= socket->sendAndRecv(); });
-  if (recv) { recv_finished_callback(); }
-  std::for_each(send_sockets.begin(), send_sockets.end(),
-                [](auto socket) { socket->sendAndRecv(); });
+                [&recv](auto socket) { recv |= socket->recv(); });
+  if (recv && recv_finished_callback) { recv_finished_callback(); }
+  // Everything queued on a socket since its last flush goes out in one
+  // syscall, sockets the kernel only partially drains wait for EPOLLOUT
+  size_t num_pending = 0;
+  for (auto socket : send_sockets) {
+    if (socket->is_dead || socket->flush()) {
+      socket->is_send_pending = false;
+    } else {
+      setSendBlocked(socket, true);
+    }
+    if (socket->is_send_pending && !socket->is_send_blocked) {
+      send_sockets[num_pending++] = socket;
+    }
+  }
+  send_sockets.resize(num_pending);
 }
 
 auto TCPServer::addToEpollList(TCPSocket* socket) noexcept -> bool {
-  epoll_event event{EPOLLET | EPOLLIN, {reinterpret_cast<void*>(socket)}};
+  epoll_event event{EPOLLIN | EPOLLRDHUP, {reinterpret_cast<void*>(socket)}};
   return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket->socket_fd, &event);
 }
 
+auto TCPServer::markSendPending(TCPSocket* socket) noexcept -> void {
+  if (!socket->is_send_pending) {
+    socket->is_send_pending = true;
+    send_sockets.push_back(socket);
+  }
+}
+
+auto TCPServer::setSendBlocked(TCPSocket* socket, bool blocked) noexcept
+    -> void {
+  socket->is_send_blocked = blocked;
+  epoll_event event{EPOLLIN | EPOLLRDHUP | (blocked ? EPOLLOUT : 0u),
+                    {reinterpret_cast<void*>(socket)}};
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, socket->socket_fd, &event);
+  if (!blocked && socket->is_send_pending) { send_sockets.push_back(socket); }
+}
+
+auto TCPServer::markDead(TCPSocket* socket) noexcept -> void {
+  if (!socket->is_dead) {
+    socket->is_dead = true;
+    dead_sockets.push_back(socket);
+  }
+}
+
+auto TCPServer::removeDeadSockets() noexcept -> void {
+  if (LIKELY(dead_sockets.empty())) { return; }
+  send_sockets.erase(std::remove_if(send_sockets.begin(), send_sockets.end(),
+                                    [](auto socket) { return socket->is_dead; }),
+                     send_sockets.end());
+  for (auto socket : dead_sockets) {
+    logger.log("%:% %() % removing socket:%\n", __FILE__, __LINE__,
+               __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+               socket->socket_fd);
+    if (disconnect_callback) { disconnect_callback(socket); }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, socket->socket_fd, nullptr);
+    close(socket->socket_fd);
+    socket->reset();
+    free_sessions.push_back(socket);
+  }
+  dead_sockets.clear();
+}
+
 }  // namespace Common
\ No newline at end of file
@@ -1,11 +1,27 @@
 #pragma once
 
+#include <memory>
+
 #include "common/TCPSocket.hpp"
 
 namespace Common {
 struct TCPServer {
-  explicit TCPServer(Logger& logger_)
-      : listener_socket(logger_), logger(logger_) {}
+  // Every session is allocated here, accepting a connection only takes a
+  // socket off the free list
+  TCPServer(Logger& logger_, size_t max_sessions,
+            size_t session_send_buffer_size, size_t session_recv_buffer_size)
+      : listener_socket(logger_, 0, 0), logger(logger_) {
+    session_pool.reserve(max_sessions);
+    free_sessions.reserve(max_sessions);
+    for (size_t i = 0; i < max_sessions; i++) {
+      session_pool.emplace_back(std::make_unique<TCPSocket>(
+          logger_, session_send_buffer_size, session_recv_buffer_size));
+      free_sessions.push_back(session_pool.back().get());
+    }
+    receive_sockets.reserve(max_sessions);
+    send_sockets.reserve(max_sessions);
+    dead_sockets.reserve(max_sessions);
+  }
 
   // Start listening for connections on the provided interface and port
   auto listen(const std::string& iface, int port) -> void;
@@ -18,18 +34,38 @@ struct TCPServer {
   // receive buffer
   auto sendAndRecv() noexcept -> void;
 
+  // Queue a socket for removal once the current round of callbacks is done,
+  // owners call it to drop a session they cannot keep serving
+  auto markDead(TCPSocket* socket) noexcept -> void;
+
 private:
   // Add socket to container
   auto addToEpollList(TCPSocket* socket) noexcept -> bool;
 
+  // Queue a socket for flushing in the next sendAndRecv()
+  auto markSendPending(TCPSocket* socket) noexcept -> void;
+
+  // Park a socket the kernel stopped taking data from until EPOLLOUT reports
+  // it writable again, or resume flushing it once it is
+  auto setSendBlocked(TCPSocket* socket, bool blocked) noexcept -> void;
+
+  // Close sockets queued by markDead() and return them to the pool
+  auto removeDeadSockets() noexcept -> void;
+
 public:
   int epoll_fd = -1;
   TCPSocket listener_socket;
   epoll_event events[(1 << 10)];
 
-  // Collectionm of all sockets, sockets for incoming data, sockets for outgoing
-  // data and dead connections
-  std::vector<TCPSocket*> receive_sockets, send_sockets;
+  // Pre-allocated sessions and the ones not bound to a connection
+  std::vector<std::unique_ptr<TCPSocket>> session_pool;
+  std::vector<TCPSocket*> free_sessions;
+
+  // Sockets reported readable by the last poll(), sockets with pending
+  // outgoing data and dead connections waiting to be freed. Membership of the
+  // last two is tracked by flags on the socket so inserts are O(1). Sockets
+  // with a full kernel send buffer leave send_sockets until EPOLLOUT.
+  std::vector<TCPSocket*> receive_sockets, send_sockets, dead_sockets;
 
   // Function Wrapper to call back when data is available
   std::function<void(TCPSocket* s, Nanos rx_time)> recv_callback = nullptr;
@@ -37,8 +73,11 @@ public:
   // Function Wrapper to call back when all data across all TCPSockets
   std::function<void()> recv_finished_callback = nullptr;
 
+  // Function Wrapper to call back before a dead connection is freed
+  std::function<void(TCPSocket* s)> disconnect_callback = nullptr;
+
   std::string time_str;
   Logger& logger;
 };
 
-}  // namespace Common
\ No newline at end of file
+}  // namespace Common
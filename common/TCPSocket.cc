@@ -16,11 +16,30 @@ auto TCPSocket::connect(const std::string& ip, const std::string& iface,
 // Called to write send data from buffers as well as check the data from the
 // recv buffer
 auto TCPSocket::sendAndRecv() noexcept -> bool {
+  const auto recv_data = recv();
+  if (hasPendingSend()) { flush(); }
+  return recv_data;
+}
+
+// Read whatever the kernel has and hand it to recv_callback
+auto TCPSocket::recv() noexcept -> bool {
   char ctrl[CMSG_SPACE(sizeof(struct timeval))];
   auto cmsg = reinterpret_cast<struct cmsghdr*>(&ctrl);
 
+  // Rewind once everything has been consumed, only pay for a move when the
+  // unread tail is about to run out of room
+  if (next_recv_read_index == next_recv_valid_index) {
+    next_recv_read_index = next_recv_valid_index = 0;
+  } else if (UNLIKELY(recv_buffer.size() - next_recv_valid_index <
+                      recv_compact_threshold)) {
+    memmove(recv_buffer.data(), recv_buffer.data() + next_recv_read_index,
+            next_recv_valid_index - next_recv_read_index);
+    next_recv_valid_index -= next_recv_read_index;
+    next_recv_read_index = 0;
+  }
+
   iovec iov{recv_buffer.data() + next_recv_valid_index,
-            TCPBufferSize - next_recv_valid_index};
+            recv_buffer.size() - next_recv_valid_index};
   msghdr msg{&socket_attribute,
              sizeof(socket_attribute),
              &iov,
@@ -45,25 +64,84 @@ auto TCPSocket::sendAndRecv() noexcept -> bool {
     logger.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n",
                __FILE__, __LINE__, __FUNCTION__,
                Common::getCurrentTimeStr(&time_str), socket_fd,
-               next_recv_valid_index, user_time, kernel_time,
+               next_recv_valid_index - next_recv_read_index, user_time,
+               kernel_time,
                (user_time - kernel_time));
     recv_callback(this, kernel_time);
   }
-  if (next_send_valid_index > 0) {
-    // This send is the POSIX function not of the class
-    const auto n = ::send(socket_fd, send_buffer.data(), next_send_valid_index,
-                          MSG_DONTWAIT | MSG_NOSIGNAL);
-    logger.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__,
-               __FUNCTION__, Common::getCurrentTimeStr(&time_str), socket_fd,
-               n);
-  }
-  next_send_valid_index = 0;
   return (read_size > 0);
 }
 
-// Write data in the send buffer
-auto TCPSocket::send(const void* data, size_t len) noexcept -> void {
-  memcpy(send_buffer.data() + next_send_valid_index, data, len);
-  next_send_valid_index += len;
+// Write as much of the send ring as the kernel takes in one syscall
+auto TCPSocket::flush() noexcept -> bool {
+  if (!next_send_size) { return true; }
+  const auto first_len =
+      std::min(next_send_size, send_buffer.size() - next_send_read_index);
+  iovec iov[2]{{send_buffer.data() + next_send_read_index, first_len},
+               {send_buffer.data(), next_send_size - first_len}};
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = (first_len < next_send_size) ? 2 : 1;
+  const auto n = sendmsg(socket_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (UNLIKELY(n < 0)) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return false;
+    }
+    // the connection is gone, nothing queued can be delivered any more
+    logger.log("%:% %() % send socket:% error:% dropped:%\n", __FILE__,
+               __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+               socket_fd, std::strerror(errno), next_send_size);
+    next_send_read_index = next_send_size = 0;
+    return true;
+  }
+  logger.log("%:% %() % send socket:% len:% queued:%\n", __FILE__, __LINE__,
+             __FUNCTION__, Common::getCurrentTimeStr(&time_str), socket_fd, n,
+             next_send_size);
+  next_send_size -= n;
+  next_send_read_index = next_send_size
+                             ? (next_send_read_index + n) % send_buffer.size()
+                             : 0;
+  return !next_send_size;
+}
+
+// Queue data in the send ring, all of it or nothing
+auto TCPSocket::send(const void* data, size_t len) noexcept -> bool {
+  if (UNLIKELY(!next_send_size) && send_pending_callback) {
+    send_pending_callback(this);
+  }
+  if (UNLIKELY(next_send_size + len > send_buffer.size())) {
+    // make room with what the kernel will take right now before giving up
+    flush();
+    if (UNLIKELY(next_send_size + len > send_buffer.size())) {
+      logger.log("%:% %() % send buffer full socket:% pending:% len:%\n",
+                 __FILE__, __LINE__, __FUNCTION__,
+                 Common::getCurrentTimeStr(&time_str), socket_fd,
+                 next_send_size, len);
+      return false;
+    }
+  }
+  auto write_index =
+      (next_send_read_index + next_send_size) % send_buffer.size();
+  const auto first_len = std::min(len, send_buffer.size() - write_index);
+  memcpy(send_buffer.data() + write_index, data, first_len);
+  memcpy(send_buffer.data(), static_cast<const char*>(data) + first_len,
+         len - first_len);
+  next_send_size += len;
+  return true;
+}
+
+// Clear connection state so a pooled socket can serve a new connection, the
+// buffers are kept as they are
+auto TCPSocket::reset() noexcept -> void {
+  socket_fd = -1;
+  next_send_read_index = next_send_size = 0;
+  next_recv_read_index = next_recv_valid_index = 0;
+  socket_attribute = {};
+  recv_callback = nullptr;
+  send_pending_callback = nullptr;
+  is_send_pending = false;
+  is_send_blocked = false;
+  is_dead = false;
+  client_id = CLIENT_ID_INVALID;
 }
 }  // namespace Common
\ No newline at end of file
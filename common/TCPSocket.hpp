@@ -1,17 +1,32 @@
 #pragma once
+#include <algorithm>
 #include <functional>
 
 #include "Logging.hpp"
 #include "common/SocketUtil.hpp"
+#include "common/Types.hpp"
 
 namespace Common {
+// Default buffer size for standalone sockets, servers size their sessions
+// explicitly
 constexpr size_t TCPBufferSize = 64 * 1024 * 1024;
+// Free space at the end of the receive buffer below which unread bytes are
+// moved back to the front before the next read, capped to a quarter of the
+// buffer for small session buffers
+constexpr size_t TCPRecvCompactThreshold = 64 * 1024;
 
 struct TCPSocket {
-  explicit TCPSocket(Logger& logger_) : logger(logger_) {
-    send_buffer.resize(TCPBufferSize);
-    recv_buffer.resize(TCPBufferSize);
-  }
+  explicit TCPSocket(Logger& logger_)
+      : TCPSocket(logger_, TCPBufferSize, TCPBufferSize) {}
+
+  // Buffers are zero-filled here so every page is faulted in up front rather
+  // than on the first send or read
+  TCPSocket(Logger& logger_, size_t send_buffer_size, size_t recv_buffer_size)
+      : send_buffer(send_buffer_size),
+        recv_buffer(recv_buffer_size),
+        recv_compact_threshold(
+            std::min(TCPRecvCompactThreshold, recv_buffer_size / 4)),
+        logger(logger_) {}
 
   // Create TCPSocket with provided attributes to either listen-on or connect-to
   auto connect(const std::string& ip, const std::string& iface, int port,
@@ -21,8 +36,26 @@ struct TCPSocket {
   // recv buffer
   auto sendAndRecv() noexcept -> bool;
 
-  // Write data in the send buffer
-  auto send(const void* data, size_t len) noexcept -> void;
+  // Read whatever the kernel has and hand it to recv_callback, returns true if
+  // anything was read
+  auto recv() noexcept -> bool;
+
+  // Write as much of the send ring as the kernel takes in one syscall, bytes
+  // it does not take stay queued for the next call. Returns true once the
+  // ring is empty.
+  auto flush() noexcept -> bool;
+
+  // Queue data in the send ring, all of it or nothing. Returns false when the
+  // ring has no room for it even after a flush, the caller then has to hold
+  // on to the data or give up on the connection since a stream cannot skip
+  // bytes.
+  auto send(const void* data, size_t len) noexcept -> bool;
+
+  auto hasPendingSend() const noexcept { return next_send_size > 0; }
+
+  // Clear connection state so a pooled socket can serve a new connection, the
+  // buffers are kept as they are
+  auto reset() noexcept -> void;
 
   TCPSocket() = delete;
 
@@ -36,16 +69,38 @@ struct TCPSocket {
 
   int socket_fd = -1;
 
+  // Send ring, queued bytes start at next_send_read_index and wrap around the
+  // end of the buffer. Everything queued between two flushes goes out in a
+  // single writev.
   std::vector<char> send_buffer;
-  size_t next_send_valid_index = 0;
+  size_t next_send_read_index = 0;
+  size_t next_send_size = 0;
+  // Received bytes live in [next_recv_read_index, next_recv_valid_index).
+  // Consumers advance next_recv_read_index instead of moving data, and may
+  // keep pointers into bytes they consumed until the next sendAndRecv() call.
   std::vector<char> recv_buffer;
+  size_t next_recv_read_index = 0;
   size_t next_recv_valid_index = 0;
+  size_t recv_compact_threshold = 0;
 
   struct sockaddr_in socket_attribute{};
 
   // Function Wrapper to callback when there is data to be processed.
   std::function<void(TCPSocket* s, Nanos rx_time)> recv_callback = nullptr;
 
+  // Function Wrapper to callback when data is queued into an empty send
+  // buffer, lets an owning TCPServer flush only sockets with pending output
+  std::function<void(TCPSocket* s)> send_pending_callback = nullptr;
+
+  // Membership flags maintained by an owning TCPServer
+  bool is_send_pending = false;
+  bool is_send_blocked = false;
+  bool is_dead = false;
+
+  // Client an owning server bound the connection to once the peer identified
+  // itself, CLIENT_ID_INVALID until then
+  ClientID client_id = CLIENT_ID_INVALID;
+
   std::string time_str;
   Logger& logger;
 };
@@ -42,30 +42,39 @@ int main(void) {
     __FILE__, __LINE__, __FUNCTION__, 
     Common::getCurrentTimeStr(&time_str));
 
- matching_engine = new Exchange::MatchingEngine(&client_request, &client_response, &market_update); 
+ const auto self_trade_prevention = Exchange::SelfTradePrevention::CANCEL_RESTING; 
+ // best levels per side published on the market by price incremental streams 
+ const size_t price_level_depth = 10; 
+
+ matching_engine = new Exchange::MatchingEngine(&client_request, &client_response, &market_update, self_trade_prevention, price_level_depth); 
  matching_engine->start();
  
  const std::string mkt_pub_iface = "lo"; 
- const std::string snap_pub_ip   = "233.252.14.1"; 
- const std::string incr_pub_ip   = "233.252.14.5"; 
- const int snap_pub_port = 20000; 
- const int inc_pub_port  = 20002; 
+ // tickers are split over channels, a consumer only joins the channels of the tickers it trades 
+ const auto mkt_pub_channels = Exchange::defaultMarketDataChannels(); 
+ const size_t mkt_pub_mtu = 1500; 
+ // a fresh snapshot every second paced to 16MB/s, recovering consumers wait about a second instead of a minute 
+ const Exchange::SnapshotSynthesizerConfig snapshot_config{1 * Common::NANOS_TO_SECS, 16 * 1024 * 1024}; 
+ // best bid and ask of every ticker at most ten times a second for dashboards and slower strategies 
+ const Exchange::ConflatedBBOConfig mkt_pub_bbo_config{"233.252.14.9", 20005, 100 * Common::NANOS_TO_MILLIS}; 
 
  logger->log("%:% %() % Starting Market Data Publisher...\n", 
    __FILE__, __LINE__, __FUNCTION__, 
    Common::getCurrentTimeStr(&time_str)
  );
- market_data_publisher = new Exchange::MarketDataPublisher(&market_update, mkt_pub_iface, snap_pub_ip, snap_pub_port, incr_pub_ip, inc_pub_port);
+ market_data_publisher = new Exchange::MarketDataPublisher(&market_update, matching_engine->bookSnapshot(), mkt_pub_iface, mkt_pub_channels, mkt_pub_mtu, snapshot_config, 
+                                                          mkt_pub_bbo_config, price_level_depth);
  market_data_publisher->start();
 
  const std::string order_gw_iface = "lo";
  const int order_gw_port = 12345;
+ const Exchange::RequestValidatorConfig validator_config{1, 1000 * 1000, 1000 * 1000}; 
 
   logger->log("%:% %() % Starting Order Server...\n", 
    __FILE__, __LINE__, __FUNCTION__, 
    Common::getCurrentTimeStr(&time_str)
   );
-  order_server = new Exchange::OrderServer(&client_request, &client_response, order_gw_iface, order_gw_port);
+  order_server = new Exchange::OrderServer(&client_request, &client_response, order_gw_iface, order_gw_port, validator_config);
   order_server->start();
 
   while(true) { 
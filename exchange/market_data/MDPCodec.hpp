@@ -0,0 +1,190 @@
+#pragma once 
+
+#include <array>
+
+#include "common/Macros.hpp"
+#include "common/Types.hpp"
+#include "MarketUpdate.hpp"
+
+using namespace Common; 
+
+namespace Exchange { 
+ // Compact market data encoding. Every update starts with one byte holding the type in the low 
+ // nibble and the side in the next two bits, followed by only the fields its type uses: 
+ //   ADD            ticker, ticker seq, order id, price, quantity, priority 
+ //   MODIFY         ticker, ticker seq, order id, price, quantity 
+ //   CANCEL         ticker, ticker seq, order id, price 
+ //   TRADE          ticker, ticker seq, price, quantity 
+ //   PRICE_LEVEL    ticker, ticker seq, price, quantity, priority (the order count) 
+ //   CLEAR          ticker, ticker seq 
+ //   SNAPSHOT_*     order id (the incremental sequence number) 
+ // Integers are LEB128 varints, order id and price are zigzag deltas from the previous update in 
+ // the same packet and the ticker sequence number from the previous one of the same ticker, so 
+ // each packet decodes on its own. Fields left out decode as *_INVALID, ticker seq as 0. 
+
+ enum MDPField : uint8_t { 
+  MDP_FIELD_TICKER   = 1 << 0, 
+  MDP_FIELD_ORDER_ID = 1 << 1, 
+  MDP_FIELD_PRICE    = 1 << 2, 
+  MDP_FIELD_QUANTITY = 1 << 3, 
+  MDP_FIELD_PRIORITY = 1 << 4, 
+  MDP_FIELD_TICKER_SEQUENCE = 1 << 5 
+ }; 
+
+ // Lead byte plus every field at its longest varint 
+ constexpr size_t MDP_MAX_ENCODED_UPDATE_SIZE = 1 + 5 + 10 + 10 + 10 + 5 + 10; 
+
+ inline auto mdpFieldMask(MarketUpdateType type) noexcept -> uint8_t { 
+  switch(type) { 
+   case MarketUpdateType::ADD: 
+    return MDP_FIELD_TICKER | MDP_FIELD_TICKER_SEQUENCE | MDP_FIELD_ORDER_ID | MDP_FIELD_PRICE | MDP_FIELD_QUANTITY | MDP_FIELD_PRIORITY; 
+   case MarketUpdateType::MODIFY: 
+    return MDP_FIELD_TICKER | MDP_FIELD_TICKER_SEQUENCE | MDP_FIELD_ORDER_ID | MDP_FIELD_PRICE | MDP_FIELD_QUANTITY; 
+   case MarketUpdateType::CANCEL: 
+    return MDP_FIELD_TICKER | MDP_FIELD_TICKER_SEQUENCE | MDP_FIELD_ORDER_ID | MDP_FIELD_PRICE; 
+   case MarketUpdateType::TRADE: 
+    return MDP_FIELD_TICKER | MDP_FIELD_TICKER_SEQUENCE | MDP_FIELD_PRICE | MDP_FIELD_QUANTITY; 
+   case MarketUpdateType::PRICE_LEVEL: 
+    return MDP_FIELD_TICKER | MDP_FIELD_TICKER_SEQUENCE | MDP_FIELD_PRICE | MDP_FIELD_QUANTITY | MDP_FIELD_PRIORITY; 
+   case MarketUpdateType::CLEAR: 
+    return MDP_FIELD_TICKER | MDP_FIELD_TICKER_SEQUENCE; 
+   case MarketUpdateType::SNAPSHOT_START: 
+   case MarketUpdateType::SNAPSHOT_END: 
+    return MDP_FIELD_ORDER_ID; 
+   case MarketUpdateType::INVALID: 
+    return 0; 
+  }
+  return 0; 
+ }
+
+ // Previous values the deltas are taken against, reset at the start of every packet 
+ struct MDPCodecState { 
+  OrderID last_order_id = 0; 
+  Price last_price = 0; 
+  std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> last_ticker_sequence_number{}; 
+
+  auto reset() noexcept -> void { 
+   last_order_id = 0; 
+   last_price = 0; 
+   last_ticker_sequence_number.fill(0); 
+  }
+
+  // Tickers outside the known range are sent in full 
+  auto lastTickerSequenceNumber(TickerID ticker_id) noexcept -> size_t * { 
+   return ticker_id < last_ticker_sequence_number.size() ? &last_ticker_sequence_number[ticker_id] : nullptr; 
+  }
+ }; 
+
+ inline auto zigzagEncode(int64_t value) noexcept -> uint64_t { 
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); 
+ }
+
+ inline auto zigzagDecode(uint64_t value) noexcept -> int64_t { 
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); 
+ }
+
+ inline auto encodeVarint(uint64_t value, char *out) noexcept -> size_t { 
+  size_t size = 0; 
+  while(value >= 0x80) { 
+   out[size++] = static_cast<char>(value | 0x80); 
+   value >>= 7; 
+  }
+  out[size++] = static_cast<char>(value); 
+  return size; 
+ }
+
+ // Returns false if the varint runs past end or past 64 bits 
+ inline auto decodeVarint(const char *&in, const char *end, uint64_t &value) noexcept -> bool { 
+  value = 0; 
+  for(unsigned shift = 0; in < end && shift < 64; shift += 7) { 
+   const auto byte = static_cast<uint8_t>(*in++); 
+   value |= static_cast<uint64_t>(byte & 0x7f) << shift; 
+   if(LIKELY(!(byte & 0x80))) { 
+    return true; 
+   }
+  }
+  return false; 
+ }
+
+ // Write update to out, which must have MDP_MAX_ENCODED_UPDATE_SIZE bytes of room, and return 
+ // the number of bytes written 
+ inline auto encodeMarketUpdate(const MatchingEngineMarketUpdate &update, size_t ticker_sequence_number, 
+                                MDPCodecState &state, char *out) noexcept -> size_t { 
+  const auto fields = mdpFieldMask(update.type); 
+  size_t size = 0; 
+  out[size++] = static_cast<char>(static_cast<uint8_t>(update.type) | 
+                                  ((static_cast<uint8_t>(static_cast<int8_t>(update.side) + 1) & 0x3) << 4)); 
+  if(fields & MDP_FIELD_TICKER) { 
+   size += encodeVarint(update.ticker_id, out + size); 
+  }
+  if(fields & MDP_FIELD_TICKER_SEQUENCE) { 
+   auto last = state.lastTickerSequenceNumber(update.ticker_id); 
+   size += encodeVarint(zigzagEncode(static_cast<int64_t>(ticker_sequence_number - (last ? *last : 0))), out + size); 
+   if(last) { 
+    *last = ticker_sequence_number; 
+   }
+  }
+  if(fields & MDP_FIELD_ORDER_ID) { 
+   size += encodeVarint(zigzagEncode(static_cast<int64_t>(update.order_id - state.last_order_id)), out + size); 
+   state.last_order_id = update.order_id; 
+  }
+  if(fields & MDP_FIELD_PRICE) { 
+   size += encodeVarint(zigzagEncode(static_cast<int64_t>(static_cast<uint64_t>(update.price) - static_cast<uint64_t>(state.last_price))), out + size); 
+   state.last_price = update.price; 
+  }
+  if(fields & MDP_FIELD_QUANTITY) { 
+   size += encodeVarint(update.quantity, out + size); 
+  }
+  if(fields & MDP_FIELD_PRIORITY) { 
+   size += encodeVarint(update.priority, out + size); 
+  }
+  return size; 
+ }
+
+ // Read one update starting at in and advance in past it, returns false on a truncated or 
+ // malformed update 
+ inline auto decodeMarketUpdate(const char *&in, const char *end, MDPCodecState &state, 
+                                MatchingEngineMarketUpdate &update, size_t &ticker_sequence_number) noexcept -> bool { 
+  if(UNLIKELY(in >= end)) { 
+   return false; 
+  }
+  const auto lead = static_cast<uint8_t>(*in++); 
+  update = {}; 
+  ticker_sequence_number = 0; 
+  update.type = static_cast<MarketUpdateType>(lead & 0xf); 
+  update.side = static_cast<Side>(static_cast<int8_t>((lead >> 4) & 0x3) - 1); 
+  const auto fields = mdpFieldMask(update.type); 
+  uint64_t value = 0; 
+  if(fields & MDP_FIELD_TICKER) { 
+   if(UNLIKELY(!decodeVarint(in, end, value))) return false; 
+   update.ticker_id = static_cast<TickerID>(value); 
+  }
+  if(fields & MDP_FIELD_TICKER_SEQUENCE) { 
+   if(UNLIKELY(!decodeVarint(in, end, value))) return false; 
+   auto last = state.lastTickerSequenceNumber(update.ticker_id); 
+   ticker_sequence_number = (last ? *last : 0) + static_cast<size_t>(zigzagDecode(value)); 
+   if(last) { 
+    *last = ticker_sequence_number; 
+   }
+  }
+  if(fields & MDP_FIELD_ORDER_ID) { 
+   if(UNLIKELY(!decodeVarint(in, end, value))) return false; 
+   state.last_order_id += static_cast<OrderID>(zigzagDecode(value)); 
+   update.order_id = state.last_order_id; 
+  }
+  if(fields & MDP_FIELD_PRICE) { 
+   if(UNLIKELY(!decodeVarint(in, end, value))) return false; 
+   state.last_price = static_cast<Price>(static_cast<uint64_t>(state.last_price) + static_cast<uint64_t>(zigzagDecode(value))); 
+   update.price = state.last_price; 
+  }
+  if(fields & MDP_FIELD_QUANTITY) { 
+   if(UNLIKELY(!decodeVarint(in, end, value))) return false; 
+   update.quantity = static_cast<Quantity>(value); 
+  }
+  if(fields & MDP_FIELD_PRIORITY) { 
+   if(UNLIKELY(!decodeVarint(in, end, value))) return false; 
+   update.priority = value; 
+  }
+  return true; 
+ }
+}
@@ -0,0 +1,86 @@
+#pragma once 
+
+#include "common/Macros.hpp"
+#include "common/McastSocket.hpp"
+#include "common/TimeUtil.hpp"
+#include "MarketUpdate.hpp"
+#include "MDPCodec.hpp"
+
+using namespace Common; 
+
+namespace Exchange { 
+ // Size of the IPv4 and UDP headers carried by every datagram on top of the payload 
+ constexpr size_t MDP_IP_UDP_HEADER_SIZE = 20 + 8; 
+
+ // Packs market data updates into packets of at most one MTU, each led by an MDPPacketHeader, 
+ // and queues every finished packet on the socket as a single datagram. Updates are written in 
+ // the compact encoding of MDPCodec.hpp. 
+ class MDPPacketWriter { 
+  public: 
+   MDPPacketWriter(McastSocket *socket_, size_t mtu) : 
+     socket(socket_), max_packet_size(mtu - MDP_IP_UDP_HEADER_SIZE) { 
+    ASSERT(mtu > MDP_IP_UDP_HEADER_SIZE + sizeof(MDPPacketHeader) + MDP_MAX_ENCODED_UPDATE_SIZE && 
+           max_packet_size <= MULTICAST_MAX_PACKET_SIZE, 
+           "MTU " + std::to_string(mtu) + " cannot carry market data packets."); 
+   }
+
+   // Append an update, the current packet is finished first if the update might not fit or 
+   // does not follow on from the sequence numbers already in it 
+   auto add(const MDPMarketUpdate &update) noexcept -> void { 
+    if(message_count && (packet_size + MDP_MAX_ENCODED_UPDATE_SIZE > max_packet_size || 
+                         update.sequence_number != base_sequence_number + message_count)) { 
+     flush(); 
+    }
+    if(!message_count) { 
+     base_sequence_number = update.sequence_number; 
+     codec_state.reset(); 
+    }
+    packet_size += encodeMarketUpdate(update.me_market_update, update.ticker_sequence_number, codec_state, packet.data() + packet_size); 
+    ++message_count; 
+   }
+
+   // Stamp and queue the packet being built, if it holds any update 
+   auto flush() noexcept -> void { 
+    if(!message_count) { 
+     return; 
+    }
+    auto header = reinterpret_cast<MDPPacketHeader *>(packet.data()); 
+    header->packet_sequence_number = next_packet_sequence_number++; 
+    header->base_sequence_number = base_sequence_number; 
+    header->packet_size = static_cast<uint16_t>(packet_size); 
+    header->message_count = message_count; 
+    header->send_time = getCurrentNanos(); 
+    socket->sendPacket(packet.data(), packet_size); 
+    bytes_sent += packet_size + MDP_IP_UDP_HEADER_SIZE; 
+    packet_size = sizeof(MDPPacketHeader); 
+    message_count = 0; 
+   }
+
+   auto pendingMessages() const noexcept { 
+    return message_count; 
+   }
+
+   // Bytes put on the wire by the packets queued so far, IP and UDP headers included 
+   auto bytesSent() const noexcept { 
+    return bytes_sent; 
+   }
+
+   MDPPacketWriter() = delete; 
+   MDPPacketWriter(const MDPPacketWriter &) = delete; 
+   MDPPacketWriter(const MDPPacketWriter &&) = delete; 
+   MDPPacketWriter &operator = (const MDPPacketWriter &) = delete; 
+   MDPPacketWriter &operator = (const MDPPacketWriter &&) = delete; 
+
+  private: 
+   McastSocket *socket = nullptr; 
+   const size_t max_packet_size; 
+   size_t next_packet_sequence_number = 1; 
+   size_t bytes_sent = 0; 
+
+   std::array<char, MULTICAST_MAX_PACKET_SIZE> packet; 
+   size_t packet_size = sizeof(MDPPacketHeader); 
+   uint16_t message_count = 0; 
+   size_t base_sequence_number = 0; 
+   MDPCodecState codec_state; 
+ }; 
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <sstream>
+
+#include "MarketUpdate.hpp"
+
+namespace Exchange {
+ // Gap fill protocol between MarketDataConsumer and MarketDataReplayServer over TCP. A consumer
+ // asks for a range of incremental sequence numbers with an MDPReplayRequest and gets back one
+ // MDPReplayResponse, followed on OK by message_count updates in the compact encoding of
+ // MDPCodec.hpp with the codec state reset at the start of the response.
+ constexpr uint16_t MDP_REPLAY_MAX_MESSAGES = 1024;
+
+ enum class MDPReplayStatus : uint8_t {
+  INVALID = 0,
+  OK = 1,
+  // The range has aged out of the server's history or is too long, the consumer has to recover
+  // from a snapshot instead
+  UNAVAILABLE = 2
+ };
+
+ inline auto mdpReplayStatusToString(MDPReplayStatus status) -> std::string {
+  switch (status) {
+  case MDPReplayStatus::INVALID:
+    return "INVALID";
+  case MDPReplayStatus::OK:
+    return "OK";
+  case MDPReplayStatus::UNAVAILABLE:
+    return "UNAVAILABLE";
+  }
+  return "UNKNOWN";
+ }
+
+#pragma pack(push, 1)
+ struct MDPReplayRequest {
+  size_t first_sequence_number = 0;
+  uint16_t message_count = 0;
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "MDPReplayRequest"
+       << " ["
+       << "first:" << first_sequence_number
+       << " count:" << message_count
+       << "]";
+    return ss.str();
+  }
+ };
+
+ struct MDPReplayResponse {
+  // Bytes in the response, this header included
+  uint32_t length = sizeof(MDPReplayResponse);
+  MDPReplayStatus status = MDPReplayStatus::INVALID;
+  size_t first_sequence_number = 0;
+  uint16_t message_count = 0;
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "MDPReplayResponse"
+       << " ["
+       << "len:" << length
+       << " status:" << mdpReplayStatusToString(status)
+       << " first:" << first_sequence_number
+       << " count:" << message_count
+       << "]";
+    return ss.str();
+  }
+ };
+#pragma pack(pop)
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/Types.hpp"
+#include "common/TimeUtil.hpp"
+#include "common/Macros.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+ // Multicast groups and replay port of one market data channel and the tickers it carries. Every channel has
+ // its own incremental sequence numbers, snapshots and replay history, so a consumer only joins the channels
+ // covering the tickers it trades.
+ struct MarketDataChannelConfig {
+  std::string incremental_ip;
+  int incremental_port = 0;
+  std::string mbp_incremental_ip;
+  int mbp_incremental_port = 0;
+  std::string snapshot_ip;
+  int snapshot_port = 0;
+  std::string mbp_snapshot_ip;
+  int mbp_snapshot_port = 0;
+  int replay_port = 0;
+  std::vector<TickerID> tickers;
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "MarketDataChannelCfg{"
+       << "incremental:" << incremental_ip << ":" << incremental_port << " "
+       << "mbp-incremental:" << mbp_incremental_ip << ":" << mbp_incremental_port << " "
+       << "snapshot:" << snapshot_ip << ":" << snapshot_port << " "
+       << "mbp-snapshot:" << mbp_snapshot_ip << ":" << mbp_snapshot_port << " "
+       << "replay-port:" << replay_port << " "
+       << "tickers:[";
+    for(size_t i = 0; i < tickers.size(); ++i) {
+      ss << (i ? "," : "") << tickerIdToString(tickers[i]);
+    }
+    ss << "]}";
+    return ss.str();
+  }
+ };
+
+ typedef std::vector<MarketDataChannelConfig> MarketDataChannelConfigs;
+
+ // Channel layout shared by the exchange and the trading clients, the tickers are split over two channels 
+ inline auto defaultMarketDataChannels() -> MarketDataChannelConfigs {
+  return {
+   {"233.252.14.5", 20002, "233.252.14.7", 20004, "233.252.14.1", 20000, "233.252.14.2", 20003, 12346, {0, 1, 2, 3}},
+   {"233.252.14.6", 20012, "233.252.14.8", 20014, "233.252.14.3", 20010, "233.252.14.4", 20013, 12347, {4, 5, 6, 7}}
+  };
+ }
+
+ // Multicast group of the conflated top of book stream, which carries the best bid and ask of every ticker
+ // at most once per interval for consumers that do not need every tick
+ struct ConflatedBBOConfig {
+  std::string ip;
+  int port = 0;
+  // Least time between two updates of the same ticker, 0 sends whatever changed on every pass of the publisher
+  Nanos interval = 100 * NANOS_TO_MILLIS;
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "ConflatedBBOCfg{"
+       << "bbo:" << ip << ":" << port << " "
+       << "interval:" << interval << "ns}";
+    return ss.str();
+  }
+ };
+
+ // Index of the channel carrying each ticker, channels.size() for a ticker no channel carries
+ inline auto channelsByTicker(const MarketDataChannelConfigs &channels) -> std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> {
+  std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> ticker_channel;
+  ticker_channel.fill(channels.size());
+  for(size_t channel_id = 0; channel_id < channels.size(); ++channel_id) {
+    for(const auto ticker_id : channels[channel_id].tickers) {
+      ASSERT(ticker_id < MATCHING_ENGINE_MAX_TICKERS && ticker_channel[ticker_id] == channels.size(),
+        "Ticker " + tickerIdToString(ticker_id) + " is out of range or carried by more than one channel.");
+      ticker_channel[ticker_id] = channel_id;
+    }
+  }
+  return ticker_channel;
+ }
+}
@@ -1,19 +1,49 @@
 #include "MarketDataPublisher.hpp"
 
+#include <algorithm>
+
 namespace Exchange {
  MarketDataPublisher::MarketDataPublisher(
-    MarketUpdateLFQueue *market_updates, const std::string &iface, 
-    const std::string &snapshot_ip, int snapshot_port, 
-    const std::string &incremental_ip, int incremental_port) : 
+    MarketUpdateLFQueue *market_updates, MatchingEngineBookSnapshot *book_snapshot, const std::string &iface, 
+    const MarketDataChannelConfigs &channel_configs, size_t mtu, 
+    const SnapshotSynthesizerConfig &snapshot_config, 
+    const ConflatedBBOConfig &bbo_config_, size_t price_level_depth_) : 
  outgoing_market_updates(market_updates), 
- snapshot_market_updates(MATCHING_ENGINE_MAX_MARKET_UPDATES), 
  is_running(false), 
  logger("exchange_market_data_publisher.log"), 
- incremental_socket(logger) 
+ ticker_channel(channelsByTicker(channel_configs)), 
+ bbo_config(bbo_config_), 
+ price_level_depth(price_level_depth_), 
+ bbo_socket(logger), 
+ bbo_packet_writer(&bbo_socket, mtu) 
  { 
-  ASSERT(incremental_socket.init(incremental_ip, iface, incremental_port, false) >= 0, 
-    "Unable to create incremental mcast socket. error : " + std::string(std::strerror(errno))); 
-  snapshot_synthesizer = new SnapshotSynthesizer(&snapshot_market_updates, iface, snapshot_ip, snapshot_port); 
+  // every update is published on its ticker's channel, so each ticker must have one 
+  for(size_t ticker_id = 0; ticker_id < ticker_channel.size(); ++ticker_id) { 
+    ASSERT(ticker_channel[ticker_id] < channel_configs.size(), 
+      "Ticker " + tickerIdToString(static_cast<TickerID>(ticker_id)) + " is not carried by any market data channel."); 
+  }
+  next_ticker_sequence_number.fill(1); 
+  next_mbp_ticker_sequence_number.fill(1); 
+  next_bbo_ticker_sequence_number.fill(1); 
+  logger.log("%:% %() % % depth:%\n", __FILE__, __LINE__, __FUNCTION__, 
+    Common::getCurrentTimeStr(&time_str), bbo_config.toString(), price_level_depth); 
+  ASSERT(bbo_socket.init(bbo_config.ip, iface, bbo_config.port, false) >= 0, 
+    "Unable to create bbo mcast socket. error : " + std::string(std::strerror(errno))); 
+  for(auto &ticker : conflated_tickers) { 
+    ticker.bids.reserve(price_level_depth + 1); 
+    ticker.asks.reserve(price_level_depth + 1); 
+  }
+  for(size_t channel_id = 0; channel_id < channel_configs.size(); ++channel_id) { 
+    const auto &channel_config = channel_configs[channel_id]; 
+    logger.log("%:% %() % Channel:% %\n", __FILE__, __LINE__, __FUNCTION__, 
+      Common::getCurrentTimeStr(&time_str), channel_id, channel_config.toString()); 
+    auto &channel = *channels.emplace_back(std::make_unique<IncrementalChannel>(channel_id, logger, iface, mtu, channel_config)); 
+    ASSERT(channel.incremental_socket.init(channel_config.incremental_ip, iface, channel_config.incremental_port, false) >= 0, 
+      "Unable to create incremental mcast socket. error : " + std::string(std::strerror(errno))); 
+    ASSERT(channel.mbp_incremental_socket.init(channel_config.mbp_incremental_ip, iface, channel_config.mbp_incremental_port, false) >= 0, 
+      "Unable to create mbp incremental mcast socket. error : " + std::string(std::strerror(errno))); 
+  }
+  snapshot_synthesizer = new SnapshotSynthesizer(book_snapshot, iface, channel_configs, mtu, snapshot_config); 
  }
  
  MarketDataPublisher::~MarketDataPublisher() { 
@@ -29,11 +59,16 @@ namespace Exchange {
   ASSERT(Common::createAndStartThread(-1, "Exchange/MarketDataPublisher", [this]() { 
    run(); }) != nullptr, "Failed to start Market Data thread."); 
   snapshot_synthesizer->start(); 
-
+  for(auto &channel : channels) { 
+    channel->replay_server.start(); 
+  }
  }
  auto MarketDataPublisher::stop() noexcept -> void { 
   is_running = false; 
   snapshot_synthesizer->stop(); 
+  for(auto &channel : channels) { 
+    channel->replay_server.stop(); 
+  }
  }
 
  auto MarketDataPublisher::run() noexcept -> void {
@@ -41,25 +76,104 @@ namespace Exchange {
   while(is_running) { 
    for(auto market_update = outgoing_market_updates->getNextToRead(); outgoing_market_updates->size() && market_update; 
       market_update = outgoing_market_updates->getNextToRead()) { 
+    auto &channel = *channels[ticker_channel.at(market_update->ticker_id)]; 
+    if(market_update->type == MarketUpdateType::PRICE_LEVEL) { 
+      publishPriceLevel(channel, *market_update); 
+      outgoing_market_updates->updateReadIndex(); 
+      continue; 
+    }
     logger.log("%:% %() % Sending seq:% %\n", 
       __FILE__, __LINE__, __FUNCTION__, 
       Common::getCurrentTimeStr(&time_str), 
-      next_increment_sequence_number,
+      channel.next_increment_sequence_number,
       market_update->toString().c_str()
     );
 
-    incremental_socket.send(&next_increment_sequence_number, sizeof(next_increment_sequence_number)); 
-    incremental_socket.send(market_update, sizeof(MatchingEngineMarketUpdate)); 
+    MDPMarketUpdate mdp_market_update{channel.next_increment_sequence_number, *market_update, 
+                                      next_ticker_sequence_number[market_update->ticker_id]++}; 
+    channel.incremental_packet_writer.add(mdp_market_update); 
 
     outgoing_market_updates->updateReadIndex(); 
 
-    auto next_write = snapshot_market_updates.getNextToWrite(); 
-    next_write->sequence_number = next_increment_sequence_number; 
-    next_write->me_market_update = *market_update;
-    snapshot_market_updates.updateWriteIndex(); 
-    ++next_increment_sequence_number; 
+    auto next_write = channel.replay_market_updates.getNextToWrite(); 
+    *next_write = mdp_market_update; 
+    channel.replay_market_updates.updateWriteIndex(); 
+    ++channel.next_increment_sequence_number; 
+   }
+   // a partly filled packet goes out now rather than waiting on the next update 
+   for(auto &channel : channels) { 
+    channel->incremental_packet_writer.flush(); 
+    channel->incremental_socket.sendAndRecv(); 
+    channel->mbp_incremental_packet_writer.flush(); 
+    channel->mbp_incremental_socket.sendAndRecv(); 
    }
-   incremental_socket.sendAndRecv(); 
+   publishConflatedBBO(); 
+  }
+ }
+
+ auto MarketDataPublisher::publishPriceLevel(IncrementalChannel &channel, const MatchingEngineMarketUpdate &market_update) noexcept -> void { 
+  logger.log("%:% %() % Sending mbp seq:% %\n", 
+    __FILE__, __LINE__, __FUNCTION__, 
+    Common::getCurrentTimeStr(&time_str), 
+    channel.next_mbp_increment_sequence_number, 
+    market_update.toString().c_str() 
+  ); 
+
+  MDPMarketUpdate mdp_market_update{channel.next_mbp_increment_sequence_number, market_update, 
+                                    next_mbp_ticker_sequence_number[market_update.ticker_id]++}; 
+  channel.mbp_incremental_packet_writer.add(mdp_market_update); 
+
+  ++channel.next_mbp_increment_sequence_number; 
+
+  conflatePriceLevel(market_update); 
+ }
+
+ auto MarketDataPublisher::conflatePriceLevel(const MatchingEngineMarketUpdate &market_update) noexcept -> void { 
+  auto &ticker = conflated_tickers.at(market_update.ticker_id); 
+  auto &levels = (market_update.side == Side::BUY ? ticker.bids : ticker.asks); 
+  // first level at or behind the updated price 
+  auto level = std::find_if(levels.begin(), levels.end(), [&market_update](const auto &other) { 
+    return market_update.side == Side::BUY ? other.price <= market_update.price : other.price >= market_update.price; 
+  }); 
+  ticker.is_changed |= (level == levels.begin()); 
+  if(level != levels.end() && level->price == market_update.price) { 
+    if(market_update.quantity) { 
+      *level = market_update; 
+    } else { 
+      levels.erase(level); 
+    }
+  } else if(market_update.quantity) { 
+    levels.insert(level, market_update); 
+    if(levels.size() > price_level_depth) { 
+      levels.pop_back(); 
+    }
+  }
+ }
+
+ auto MarketDataPublisher::publishConflatedBBO() noexcept -> void { 
+  const auto now = getCurrentNanos(); 
+  for(TickerID ticker_id = 0; ticker_id < conflated_tickers.size(); ++ticker_id) { 
+    auto &ticker = conflated_tickers[ticker_id]; 
+    if(!ticker.is_changed || now - ticker.last_publish_time < bbo_config.interval) { 
+      continue; 
+    }
+    for(const auto side : {Side::BUY, Side::SELL}) { 
+      const auto &levels = (side == Side::BUY ? ticker.bids : ticker.asks); 
+      const auto best = (levels.empty() ? 
+                         MatchingEngineMarketUpdate{MarketUpdateType::PRICE_LEVEL, ORDER_ID_INVALID, ticker_id, side, PRICE_INVALID, 0, 0} : 
+                         levels.front()); 
+      logger.log("%:% %() % Sending bbo seq:% %\n", 
+        __FILE__, __LINE__, __FUNCTION__, 
+        Common::getCurrentTimeStr(&time_str), 
+        next_bbo_sequence_number, 
+        best.toString().c_str() 
+      ); 
+      bbo_packet_writer.add({next_bbo_sequence_number++, best, next_bbo_ticker_sequence_number[ticker_id]++}); 
+    }
+    ticker.is_changed = false; 
+    ticker.last_publish_time = now; 
   }
+  bbo_packet_writer.flush(); 
+  bbo_socket.sendAndRecv(); 
  }
 } 
@@ -1,15 +1,20 @@
 #pragma once 
 #include <functional> 
+#include <memory> 
 #include "MarketUpdate.hpp"
+#include "MarketDataChannel.hpp"
 #include "common/McastSocket.hpp"
+#include "MDPPacketWriter.hpp"
 #include "SnapshotSynthesizer.hpp"
+#include "MarketDataReplayServer.hpp"
 
 namespace Exchange { 
  class MarketDataPublisher {
    public : 
-    MarketDataPublisher(MarketUpdateLFQueue *market_updates, const std::string &iface, 
-            const std::string &snapshot_ip, int snapshot_port, 
-            const std::string &incremental_ip, int incremental_port);
+    MarketDataPublisher(MarketUpdateLFQueue *market_updates, MatchingEngineBookSnapshot *book_snapshot, const std::string &iface, 
+            const MarketDataChannelConfigs &channels, size_t mtu, 
+            const SnapshotSynthesizerConfig &snapshot_config, 
+            const ConflatedBBOConfig &bbo_config, size_t price_level_depth);
              
     ~MarketDataPublisher(); 
 
@@ -26,22 +31,87 @@ namespace Exchange {
     MarketDataPublisher &operator = (const MarketDataPublisher&&) = delete; 
     
    private : 
-    // Sequence number to keep track on the incremental stream 
-    size_t next_increment_sequence_number = 1; 
+    // Sequence number of the next update of each ticker on the incremental stream 
+    std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> next_ticker_sequence_number; 
+    // Sequence number of the next price level update of each ticker on the market by price incremental stream 
+    std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> next_mbp_ticker_sequence_number; 
 
     // Lock free queue from which we consume the update sent by matching engines 
     MarketUpdateLFQueue *outgoing_market_updates = nullptr; 
     
-    // Lock free queue on which we forward the incremental market data updates sent to the snapshot synthesis
-    MDPMarketUpdateLFQueue snapshot_market_updates; 
-    
     volatile bool is_running = false; 
 
     std::string time_str; 
     Logger logger;
-    // Multicast socket to propagate incremental data stream    
-    Common::McastSocket incremental_socket; 
+
+    // Incremental stream of one market data channel 
+    struct IncrementalChannel { 
+      // Sequence number to keep track on the incremental stream 
+      size_t next_increment_sequence_number = 1; 
+
+      // Multicast socket to propagate incremental data stream    
+      Common::McastSocket incremental_socket; 
+      // Packs incremental updates into MTU sized packets on the incremental socket 
+      MDPPacketWriter incremental_packet_writer; 
+
+      // Sequence number and multicast socket of the market by price incremental stream, which carries the 
+      // PRICE_LEVEL updates of the best levels instead of every order 
+      size_t next_mbp_increment_sequence_number = 1; 
+      Common::McastSocket mbp_incremental_socket; 
+      MDPPacketWriter mbp_incremental_packet_writer; 
+
+      // Lock free queue on which we forward the incremental market data updates kept for gap fill 
+      MDPMarketUpdateLFQueue replay_market_updates; 
+
+      // Replay server which serves recent incremental updates to consumers filling a gap 
+      MarketDataReplayServer replay_server; 
+
+      IncrementalChannel(size_t channel_id, Logger &logger, const std::string &iface, size_t mtu, 
+                         const MarketDataChannelConfig &channel_config) : 
+        incremental_socket(logger), 
+        incremental_packet_writer(&incremental_socket, mtu), 
+        mbp_incremental_socket(logger), 
+        mbp_incremental_packet_writer(&mbp_incremental_socket, mtu), 
+        replay_market_updates(MATCHING_ENGINE_MAX_MARKET_UPDATES), 
+        replay_server(channel_id, &replay_market_updates, iface, channel_config.replay_port) {} 
+    }; 
+    std::vector<std::unique_ptr<IncrementalChannel>> channels; 
+
+    // Index into channels of the channel carrying each ticker 
+    const std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> ticker_channel; 
+
+    const ConflatedBBOConfig bbo_config; 
+    // Levels per side the matching engine sends PRICE_LEVEL updates for, levels pushed beyond it are dropped 
+    const size_t price_level_depth = 0; 
+
+    // Best levels of one ticker built from its PRICE_LEVEL updates and when its top of book last went out on 
+    // the conflated stream 
+    struct ConflatedTicker { 
+      // Visible levels of each side best first 
+      std::vector<MatchingEngineMarketUpdate> bids, asks; 
+      bool is_changed = false; 
+      Nanos last_publish_time = 0; 
+    }; 
+    std::array<ConflatedTicker, MATCHING_ENGINE_MAX_TICKERS> conflated_tickers; 
+
+    // Sequence numbers and multicast socket of the conflated top of book stream, shared by all channels 
+    size_t next_bbo_sequence_number = 1; 
+    std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> next_bbo_ticker_sequence_number; 
+    Common::McastSocket bbo_socket; 
+    MDPPacketWriter bbo_packet_writer; 
+
     // Snapshot synthesize which synthesizes and publishes limit order book snapshots 
     SnapshotSynthesizer *snapshot_synthesizer = nullptr; 
+
+    // Send a PRICE_LEVEL update on the channel's market by price incremental stream, it has no replay so 
+    // consumers recover it from the market by price snapshots 
+    auto publishPriceLevel(IncrementalChannel &channel, const MatchingEngineMarketUpdate &market_update) noexcept -> void; 
+
+    // Apply a PRICE_LEVEL update to the ticker's conflated levels and mark it changed if its best level moved 
+    auto conflatePriceLevel(const MatchingEngineMarketUpdate &market_update) noexcept -> void; 
+
+    // Send the best bid and ask of every changed ticker whose interval has passed, as one PRICE_LEVEL per side 
+    // with quantity 0 for an empty side 
+    auto publishConflatedBBO() noexcept -> void; 
  }; 
-}
\ No newline at end of file
+}
@@ -0,0 +1,136 @@
+#include "MarketDataReplayServer.hpp"
+
+#include <algorithm>
+
+namespace Exchange {
+ MarketDataReplayServer::MarketDataReplayServer(
+    size_t channel_id,
+    MDPMarketUpdateLFQueue *market_updates,
+    const std::string &iface_,
+    int port_) :
+    replay_md_updates(market_updates),
+    iface(iface_),
+    port(port_),
+    logger("exchange_market_data_replay_server_" + std::to_string(channel_id) + ".log"),
+    tcp_server(logger, MATCHING_ENGINE_MAX_NUM_CLIENTS, MDP_REPLAY_SESSION_SEND_BUFFER_SIZE, MDP_REPLAY_SESSION_RECV_BUFFER_SIZE),
+    history(MDP_REPLAY_HISTORY_SIZE)
+    {
+      deferred_sockets.reserve(MATCHING_ENGINE_MAX_NUM_CLIENTS);
+      retry_sockets.reserve(MATCHING_ENGINE_MAX_NUM_CLIENTS);
+      tcp_server.recv_callback = [this](auto socket, auto rx_time) {
+        recvCallback(socket, rx_time);
+      };
+      tcp_server.disconnect_callback = [this](auto socket) {
+        disconnectCallback(socket);
+      };
+    }
+
+ MarketDataReplayServer::~MarketDataReplayServer() {
+   stop();
+ }
+
+ auto MarketDataReplayServer::start() noexcept -> void {
+  is_running = true;
+  tcp_server.listen(iface, port);
+  ASSERT(Common::createAndStartThread(-1, "Exchange/MarketDataReplayServer", [this]() {
+    run(); }) != nullptr, "Failed to start MarketDataReplayServer thread.");
+ }
+
+ auto MarketDataReplayServer::stop() noexcept -> void {
+  is_running = false;
+ }
+
+ auto MarketDataReplayServer::recvCallback(TCPSocket *socket, Nanos rx_time) noexcept -> void {
+  auto read_index = socket->next_recv_read_index;
+  for(; read_index + sizeof(MDPReplayRequest) <= socket->next_recv_valid_index; read_index += sizeof(MDPReplayRequest)) {
+    const auto request = reinterpret_cast<const MDPReplayRequest *>(socket->recv_buffer.data() + read_index);
+    logger.log("%:% %() % Received socket:% rx:% %\n",
+      __FILE__, __LINE__, __FUNCTION__,
+      getCurrentTimeStr(&time_str), socket->socket_fd, rx_time, request->toString()
+    );
+    if(!sendReplay(socket, *request)) {
+      // leave this and later requests in the socket buffer until the updates arrive
+      if(std::find(deferred_sockets.begin(), deferred_sockets.end(), socket) == deferred_sockets.end()) {
+        deferred_sockets.push_back(socket);
+      }
+      break;
+    }
+  }
+  socket->next_recv_read_index = read_index;
+ }
+
+ auto MarketDataReplayServer::sendReplay(TCPSocket *socket, const MDPReplayRequest &request) noexcept -> bool {
+  const auto first_available = (last_increment_sequence_number >= MDP_REPLAY_HISTORY_SIZE ?
+                                last_increment_sequence_number - MDP_REPLAY_HISTORY_SIZE + 1 : 1);
+  auto header = reinterpret_cast<MDPReplayResponse *>(response.data());
+  *header = {};
+  header->first_sequence_number = request.first_sequence_number;
+  // the range comes off the wire, bound its start before adding the count to it so it cannot wrap
+  if(UNLIKELY(!request.message_count || request.message_count > MDP_REPLAY_MAX_MESSAGES ||
+              request.first_sequence_number < first_available ||
+              request.first_sequence_number > last_increment_sequence_number + MDP_REPLAY_HISTORY_SIZE ||
+              request.first_sequence_number + request.message_count - 1 > last_increment_sequence_number + MDP_REPLAY_HISTORY_SIZE)) {
+    header->status = MDPReplayStatus::UNAVAILABLE;
+    logger.log("%:% %() % Cannot replay % history:[%,%] %\n",
+      __FILE__, __LINE__, __FUNCTION__,
+      getCurrentTimeStr(&time_str), request.toString(), first_available, last_increment_sequence_number, header->toString()
+    );
+    // a session too slow to take the answer keeps the request until it drains
+    return socket->send(header, header->length);
+  }
+  const auto last_requested = request.first_sequence_number + request.message_count - 1;
+  if(last_requested > last_increment_sequence_number) {
+    return false;
+  }
+  MDPCodecState codec_state;
+  size_t length = sizeof(MDPReplayResponse);
+  for(auto sequence_number = request.first_sequence_number; sequence_number <= last_requested; ++sequence_number) {
+    const auto &market_update = history[sequence_number & (MDP_REPLAY_HISTORY_SIZE - 1)];
+    length += encodeMarketUpdate(market_update.me_market_update, market_update.ticker_sequence_number,
+                                 codec_state, response.data() + length);
+  }
+  header->length = static_cast<uint32_t>(length);
+  header->status = MDPReplayStatus::OK;
+  header->message_count = request.message_count;
+  logger.log("%:% %() % Replaying %\n",
+    __FILE__, __LINE__, __FUNCTION__,
+    getCurrentTimeStr(&time_str), header->toString()
+  );
+  return socket->send(response.data(), length);
+ }
+
+ auto MarketDataReplayServer::retryDeferred() noexcept -> void {
+  retry_sockets.swap(deferred_sockets);
+  for(auto socket : retry_sockets) {
+    recvCallback(socket, getCurrentNanos());
+  }
+  retry_sockets.clear();
+ }
+
+ auto MarketDataReplayServer::disconnectCallback(TCPSocket *socket) noexcept -> void {
+  logger.log("%:% %() % Consumer disconnected from socket:%\n",
+    __FILE__, __LINE__, __FUNCTION__,
+    getCurrentTimeStr(&time_str), socket->socket_fd
+  );
+  deferred_sockets.erase(std::remove(deferred_sockets.begin(), deferred_sockets.end(), socket), deferred_sockets.end());
+ }
+
+ auto MarketDataReplayServer::run() noexcept -> void {
+  logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str));
+  while(is_running) {
+    for(auto market_update = replay_md_updates->getNextToRead(); replay_md_updates->size() && market_update;
+        market_update = replay_md_updates->getNextToRead()) {
+      ASSERT(market_update->sequence_number == last_increment_sequence_number + 1,
+        "Expected incremental sequence number to increase");
+      history[market_update->sequence_number & (MDP_REPLAY_HISTORY_SIZE - 1)] = *market_update;
+      last_increment_sequence_number = market_update->sequence_number;
+      replay_md_updates->updateReadIndex();
+    }
+    if(UNLIKELY(!deferred_sockets.empty())) {
+      retryDeferred();
+    }
+    tcp_server.poll();
+    tcp_server.sendAndRecv();
+  }
+ }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include "common/Types.hpp"
+#include "common/ThreadUtil.hpp"
+#include "common/LockFreeQueue.hpp"
+#include "common/Macros.hpp"
+#include "common/TCPServer.hpp"
+#include "common/Logging.hpp"
+#include "MarketUpdate.hpp"
+#include "MDPCodec.hpp"
+#include "MDPReplay.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+   // Incremental updates kept for gap fill, a power of two so the sequence number indexes the ring
+   constexpr size_t MDP_REPLAY_HISTORY_SIZE = 64 * 1024;
+   static_assert((MDP_REPLAY_HISTORY_SIZE & (MDP_REPLAY_HISTORY_SIZE - 1)) == 0);
+
+   // Per session buffers, room for a few full responses and requests in flight
+   constexpr size_t MDP_REPLAY_SESSION_SEND_BUFFER_SIZE = 128 * 1024;
+   constexpr size_t MDP_REPLAY_SESSION_RECV_BUFFER_SIZE = 16 * 1024;
+
+   // Keeps the last MDP_REPLAY_HISTORY_SIZE incremental updates of one market data channel and serves
+   // MDPReplayRequests for them over TCP, so consumers fill small gaps without waiting for a snapshot
+   class MarketDataReplayServer {
+    public:
+      MarketDataReplayServer(size_t channel_id, MDPMarketUpdateLFQueue *market_updates, const std::string &iface, int port);
+
+      ~MarketDataReplayServer() noexcept;
+
+      auto start() noexcept -> void;
+
+      auto stop() noexcept -> void;
+
+      auto run() noexcept -> void;
+
+      MarketDataReplayServer() = delete;
+      MarketDataReplayServer(const MarketDataReplayServer &)  = delete;
+      MarketDataReplayServer(const MarketDataReplayServer &&) = delete;
+      MarketDataReplayServer &operator = (const MarketDataReplayServer &)  = delete;
+      MarketDataReplayServer &operator = (const MarketDataReplayServer &&) = delete;
+
+    private:
+      // Lock free queue containing incremental market data updates
+      MDPMarketUpdateLFQueue *replay_md_updates = nullptr;
+      const std::string iface;
+      const int port = 0;
+      Logger logger;
+      volatile bool is_running = false;
+
+      std::string time_str;
+
+      Common::TCPServer tcp_server;
+
+      // Ring of the most recent incremental updates, update n lives at n % MDP_REPLAY_HISTORY_SIZE
+      std::vector<MDPMarketUpdate> history;
+      size_t last_increment_sequence_number = 0;
+
+      // Sessions with a request for updates not received yet, retried as the history grows
+      std::vector<TCPSocket*> deferred_sockets, retry_sockets;
+
+      // Encoded response being built
+      std::array<char, sizeof(MDPReplayResponse) + MDP_REPLAY_MAX_MESSAGES * MDP_MAX_ENCODED_UPDATE_SIZE> response;
+
+      // Serve every complete request in the session's buffer
+      auto recvCallback(TCPSocket *socket, Nanos rx_time) noexcept -> void;
+
+      // Answer one request, returns false if it reaches past the updates received so far or the
+      // session's send buffer has no room for the answer
+      auto sendReplay(TCPSocket *socket, const MDPReplayRequest &request) noexcept -> bool;
+
+      auto retryDeferred() noexcept -> void;
+
+      auto disconnectCallback(TCPSocket *socket) noexcept -> void;
+   };
+}
@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "common/LockFreeQueue.hpp"
+#include "common/TimeUtil.hpp"
 #include "common/Types.hpp"
 
 using namespace Common;
@@ -16,7 +17,11 @@ enum class MarketUpdateType : uint8_t {
   CANCEL = 4,
   TRADE = 5, 
   SNAPSHOT_START = 6, 
-  SNAPSHOT_END   = 7
+  SNAPSHOT_END   = 7, 
+  // Aggregated price level on the market-by-price streams, quantity is the total resting quantity 
+  // and priority the number of orders at the level. On the incremental stream a quantity of 0 
+  // removes the level. 
+  PRICE_LEVEL    = 8
 };
 
 inline std::string marketUpdateTypeToString(MarketUpdateType type) {
@@ -37,6 +42,8 @@ inline std::string marketUpdateTypeToString(MarketUpdateType type) {
     return "SNAPSHOT_END"; 
   case MarketUpdateType::CLEAR: 
     return "CLEAR"; 
+  case MarketUpdateType::PRICE_LEVEL: 
+    return "PRICE_LEVEL"; 
   }
   return "UNKNOWN";
 }
@@ -68,17 +75,44 @@ struct MatchingEngineMarketUpdate {
 struct MDPMarketUpdate { 
   size_t sequence_number = 0; 
   MatchingEngineMarketUpdate me_market_update; 
+  // Position of the update among the updates of its ticker starting at 1, lets a consumer tell 
+  // which tickers a gap in sequence_number touched. On a snapshot CLEAR it is the ticker's last 
+  // update reflected by the snapshot, 0 on updates that carry no ticker. 
+  size_t ticker_sequence_number = 0; 
   auto toString() const { 
     std::stringstream ss; 
     ss << "MDPMarketUpdate"
          << " ["
          << " seq:" << sequence_number
+         << " ticker-seq:" << ticker_sequence_number
          << " " << me_market_update.toString()
          << "]";
     return ss.str();
   }
 }; 
 
+// Leads every market data packet, followed by message_count updates in the compact encoding of
+// MDPCodec.hpp. The updates carry consecutive sequence numbers starting at base_sequence_number.
+struct MDPPacketHeader { 
+  size_t packet_sequence_number = 0; 
+  size_t base_sequence_number = 0; 
+  uint16_t packet_size = 0; 
+  uint16_t message_count = 0; 
+  Nanos send_time = 0; 
+  auto toString() const { 
+    std::stringstream ss; 
+    ss << "MDPPacketHeader"
+         << " ["
+         << " pkt-seq:" << packet_sequence_number
+         << " base-seq:" << base_sequence_number
+         << " size:" << packet_size
+         << " count:" << message_count
+         << " send-time:" << send_time
+         << "]";
+    return ss.str();
+  }
+}; 
+
 #pragma pack(pop)
 
 typedef LockFreeQueue<MatchingEngineMarketUpdate> MarketUpdateLFQueue;
@@ -1,21 +1,28 @@
 #include "SnapshotSynthesizer.hpp"
 
+#include <algorithm>
+#include <limits>
+
 namespace Exchange { 
  SnapshotSynthesizer::SnapshotSynthesizer(
-    MDPMarketUpdateLFQueue *market_updates, 
+    MatchingEngineBookSnapshot *book_snapshot_, 
     const std::string &iface, 
-    const std::string &snapshot_ip, 
-    int snapshot_port) : 
-    snapshot_md_updates(market_updates), 
+    const MarketDataChannelConfigs &channel_configs, 
+    size_t mtu, 
+    const SnapshotSynthesizerConfig &config_) : 
     logger("exchange_snapshot_synthesizer.log"), 
-    snapshot_socket(logger), 
-    order_pool(MATCHING_ENGINE_MAX_ORDER_IDS)
+    config(config_), 
+    book_snapshot(book_snapshot_) 
     { 
-        ASSERT(snapshot_socket.init(snapshot_ip, iface, snapshot_port, false) >= 0, 
-         "Unable to create snapshot mcast socket. error: " + std::string(std::strerror(errno)));
-        for(auto &orders : ticker_orders) { 
-            orders.fill(nullptr); 
-        }  
+        for(const auto &channel_config : channel_configs) { 
+            auto &channel = *channels.emplace_back(std::make_unique<SnapshotChannel>(logger, mtu, channel_config)); 
+            ASSERT(channel.snapshot_socket.init(channel_config.snapshot_ip, iface, channel_config.snapshot_port, false) >= 0, 
+             "Unable to create snapshot mcast socket. error: " + std::string(std::strerror(errno)));
+            ASSERT(channel.mbp_snapshot_socket.init(channel_config.mbp_snapshot_ip, iface, channel_config.mbp_snapshot_port, false) >= 0, 
+             "Unable to create mbp snapshot mcast socket. error: " + std::string(std::strerror(errno)));
+        }
+        logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, 
+          getCurrentTimeStr(&time_str), config.toString()); 
     }
  SnapshotSynthesizer::~SnapshotSynthesizer() { 
    stop(); 
@@ -31,132 +38,135 @@ namespace Exchange {
   is_running = false; 
  }
 
- auto SnapshotSynthesizer::addToSnapshot(const MDPMarketUpdate *market_update) noexcept -> void { 
-   const auto &me_market_update = market_update->me_market_update;
-   auto *orders = &ticker_orders.at(me_market_update.ticker_id);
-   switch (me_market_update.type) { 
-     case MarketUpdateType::ADD : { 
-       auto order = orders->at(me_market_update.order_id); 
-       ASSERT(order == nullptr, "Received : " + me_market_update.toString() + " but already exists : " + (order ? order->toString() : "")); 
-       orders->at(me_market_update.order_id) = order_pool.allocate(me_market_update); 
-     }
-     break;
-     
-     case MarketUpdateType::MODIFY : { 
-      auto order = orders->at(me_market_update.order_id); 
-      ASSERT(order != nullptr, "Received : " + me_market_update.toString() + " but order does not exist.");
-      ASSERT(order->order_id == me_market_update.order_id, "Expecting existing order to match the new one."); 
-      ASSERT(order->side     == me_market_update.side    , "Expecting existing order to match the new one."); 
-      order->quantity = me_market_update.quantity; 
-      order->price    = me_market_update.price; 
-     }
-     break; 
-
-     case MarketUpdateType::CANCEL : { 
-      auto order = orders->at(me_market_update.order_id); 
-      ASSERT(order != nullptr, "Received : " + me_market_update.toString() + " but order does not exist.");
-      ASSERT(order->order_id == me_market_update.order_id, "Expecting existing order to match the new one."); 
-      ASSERT(order->side     == me_market_update.side    , "Expecting existing order to match the new one."); 
-      order_pool.deallocate(order); 
-      orders->at(me_market_update.order_id) = nullptr;  
-    }
-    break; 
-    case MarketUpdateType::SNAPSHOT_START:
-    case MarketUpdateType::CLEAR: 
-    case MarketUpdateType::SNAPSHOT_END: 
-    case MarketUpdateType::TRADE:
-    case MarketUpdateType::INVALID:
-     break; 
-   }
-   ASSERT(market_update->sequence_number == last_increment_sequence_number + 1, 
-    "Expected incremental sequence number to increase"); 
-   last_increment_sequence_number = market_update->sequence_number; 
+ auto SnapshotSynthesizer::publishSnapshot() noexcept -> void { 
+  for(auto &channel : channels) { 
+    publishOrderSnapshot(*channel); 
+    publishPriceLevelSnapshot(*channel); 
+  }
  }
 
+ auto SnapshotSynthesizer::publishOrderSnapshot(SnapshotChannel &channel) noexcept -> void { 
+  auto &snapshot_msgs = channel.snapshot_msgs; 
+  // every update of the channel has one ticker sequence number, so their sum counts the channel's updates the 
+  // snapshot covers. Consumers sync each ticker on its CLEAR, the books may be captured on different passes. 
+  size_t last_increment_sequence_number = 0; 
+  for(const auto ticker_id : channel.tickers) { 
+    last_increment_sequence_number += book_snapshot->tickers.at(ticker_id).last_sequence_number; 
+  }
+  snapshot_msgs.clear(); 
+  channel.next_snapshot_msg = 0; 
+  snapshot_msgs.push_back({snapshot_msgs.size(), {MarketUpdateType::SNAPSHOT_START, last_increment_sequence_number}}); 
+  for(const auto ticker_id : channel.tickers) { 
+    const auto &ticker_snapshot = book_snapshot->tickers[ticker_id]; 
+    MatchingEngineMarketUpdate me_market_update; 
+    me_market_update.type = MarketUpdateType::CLEAR; 
+    me_market_update.ticker_id = ticker_id;  
+    snapshot_msgs.push_back({snapshot_msgs.size(), me_market_update, ticker_snapshot.last_sequence_number}); 
 
- auto SnapshotSynthesizer::publishSnapshot() noexcept -> void { 
-  size_t snapshot_size = 0; 
-  const MDPMarketUpdate start_market_update { 
-   snapshot_size++, 
-   {
-    MarketUpdateType::SNAPSHOT_START, 
+    // priority order within each price level, so the rebuilt book keeps queue positions
+    for(const auto &order : ticker_snapshot.orders) { 
+      snapshot_msgs.push_back({snapshot_msgs.size(), order}); 
+    }
+  }
+  snapshot_msgs.push_back({snapshot_msgs.size(), {MarketUpdateType::SNAPSHOT_END, last_increment_sequence_number}}); 
+  logger.log("%:% %() % Built snapshot of % orders at seq:%.\n", 
+    __FILE__, __LINE__, __FUNCTION__, 
+    getCurrentTimeStr(&time_str), snapshot_msgs.size() - 2 - channel.tickers.size(), 
     last_increment_sequence_number
-   }
-  }; 
+  );  
+ }
 
-  logger.log("%:% %() % %\n", 
+ auto SnapshotSynthesizer::publishPriceLevelSnapshot(SnapshotChannel &channel) noexcept -> void { 
+  auto &mbp_snapshot_msgs = channel.mbp_snapshot_msgs; 
+  size_t last_increment_sequence_number = 0; 
+  for(const auto ticker_id : channel.tickers) { 
+    last_increment_sequence_number += book_snapshot->tickers.at(ticker_id).last_mbp_sequence_number; 
+  }
+  mbp_snapshot_msgs.clear(); 
+  channel.next_mbp_snapshot_msg = 0; 
+  size_t num_price_levels = 0; 
+  mbp_snapshot_msgs.push_back({mbp_snapshot_msgs.size(), {MarketUpdateType::SNAPSHOT_START, last_increment_sequence_number}}); 
+  for(const auto ticker_id : channel.tickers) { 
+    const auto &ticker_snapshot = book_snapshot->tickers[ticker_id]; 
+    MatchingEngineMarketUpdate me_market_update; 
+    me_market_update.type = MarketUpdateType::CLEAR; 
+    me_market_update.ticker_id = ticker_id; 
+    mbp_snapshot_msgs.push_back({mbp_snapshot_msgs.size(), me_market_update, ticker_snapshot.last_mbp_sequence_number}); 
+
+    // bids best first then asks best first
+    for(const auto &price_level : ticker_snapshot.price_levels) { 
+      mbp_snapshot_msgs.push_back({mbp_snapshot_msgs.size(), price_level, ticker_snapshot.last_mbp_sequence_number}); 
+    }
+    num_price_levels += ticker_snapshot.price_levels.size(); 
+  }
+  mbp_snapshot_msgs.push_back({mbp_snapshot_msgs.size(), {MarketUpdateType::SNAPSHOT_END, last_increment_sequence_number}}); 
+  logger.log("%:% %() % Built snapshot of % price levels at seq:%.\n", 
     __FILE__, __LINE__, __FUNCTION__, 
-    getCurrentTimeStr(&time_str), start_market_update.toString()
+    getCurrentTimeStr(&time_str), num_price_levels, last_increment_sequence_number
   ); 
+ }
 
-  snapshot_socket.send(&start_market_update, sizeof(MDPMarketUpdate)); 
-  snapshot_socket.sendAndRecv(); 
-  for(size_t ticker_id = 0; ticker_id < ticker_orders.size(); ticker_id++) { 
-    const auto &orders = ticker_orders.at(ticker_id); 
-
-    MatchingEngineMarketUpdate me_market_update; 
-    me_market_update.type = MarketUpdateType::CLEAR; 
-    me_market_update.ticker_id = static_cast<TickerID>(ticker_id);  
+ auto SnapshotSynthesizer::sendSnapshots() noexcept -> void { 
+  if(config.max_bytes_per_sec) { 
+    const auto now = getCurrentNanos(); 
+    // cap the allowance at one batch of packets so an idle spell does not turn into a burst 
+    send_allowance = std::min(send_allowance + static_cast<double>(now - last_allowance_time) * static_cast<double>(config.max_bytes_per_sec) / NANOS_TO_SECS, 
+                              static_cast<double>(MULTICAST_MAX_BATCH_PACKETS * MULTICAST_MAX_PACKET_SIZE)); 
+    last_allowance_time = now; 
+  } else { 
+    send_allowance = std::numeric_limits<double>::max(); 
+  }
+  // the price level snapshots are far smaller, they go first so depth only subscribers recover soonest 
+  for(auto &channel : channels) { 
+    sendMessages(channel->mbp_snapshot_msgs, channel->next_mbp_snapshot_msg, channel->mbp_snapshot_socket, channel->mbp_snapshot_packet_writer); 
+  }
+  for(auto &channel : channels) { 
+    sendMessages(channel->snapshot_msgs, channel->next_snapshot_msg, channel->snapshot_socket, channel->snapshot_packet_writer); 
+  }
+ }
 
-    const MDPMarketUpdate clear_market_update{ 
-      snapshot_size++, 
-      me_market_update
-    }; 
-    
-    logger.log("%:% %() % %\n", 
+ auto SnapshotSynthesizer::sendMessages(const std::vector<MDPMarketUpdate> &msgs, size_t &next_msg, 
+                                        McastSocket &socket, MDPPacketWriter &packet_writer) noexcept -> void { 
+  for(; next_msg < msgs.size() && send_allowance > 0; ++next_msg) { 
+    logger.log("%:% %() % % %\n", 
       __FILE__, __LINE__, __FUNCTION__, 
-     getCurrentTimeStr(&time_str), clear_market_update.toString()
+      getCurrentTimeStr(&time_str), next_msg, msgs[next_msg].toString()
     ); 
-    snapshot_socket.send(&clear_market_update, sizeof(MDPMarketUpdate)); 
-
-    for(const auto order : orders) { 
-     if(order) { 
-      const MDPMarketUpdate propagate_market_update { 
-       snapshot_size++, 
-       *order 
-      }; 
-      logger.log("%:% %() % %\n", 
-        __FILE__, __LINE__, __FUNCTION__, 
-        getCurrentTimeStr(&time_str), propagate_market_update.toString()
-      ); 
-      snapshot_socket.send(&propagate_market_update, sizeof(MDPMarketUpdate));
-      snapshot_socket.sendAndRecv();  
-     }
+    // the allowance is charged as packets fill, the last one may overdraw it by a packet 
+    const auto bytes_sent = packet_writer.bytesSent(); 
+    packet_writer.add(msgs[next_msg]); 
+    send_allowance -= static_cast<double>(packet_writer.bytesSent() - bytes_sent); 
+    // updates are packed many to a packet, hand the kernel a full batch of packets at a time
+    if(socket.pendingPackets() > MULTICAST_MAX_BATCH_PACKETS) { 
+      socket.sendAndRecv(); 
     }
   }
-  const MDPMarketUpdate end_market_update { 
-    snapshot_size++, 
-    {MarketUpdateType::SNAPSHOT_END, last_increment_sequence_number} 
-  }; 
-  logger.log("%:% %() % %\n", 
-    __FILE__, __LINE__, __FUNCTION__, 
-    getCurrentTimeStr(&time_str), end_market_update.toString()
-  ); 
-  snapshot_socket.send(&end_market_update, sizeof(MDPMarketUpdate));
-  snapshot_socket.sendAndRecv(); 
-  logger.log("%:% %() % Published snapshot of % orders.\n", 
-    __FILE__, __LINE__, __FUNCTION__, 
-    getCurrentTimeStr(&time_str), snapshot_size - 1
-  );  
+  if(next_msg == msgs.size()) { 
+    const auto bytes_sent = packet_writer.bytesSent(); 
+    packet_writer.flush(); 
+    send_allowance -= static_cast<double>(packet_writer.bytesSent() - bytes_sent); 
+  }
+  // packets the kernel would not take last time are retried here too 
+  if(socket.pendingPackets()) { 
+    socket.sendAndRecv(); 
+  }
  }
 
  auto SnapshotSynthesizer::run() noexcept -> void { 
   logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&time_str));
+  last_allowance_time = getCurrentNanos(); 
   while(is_running) { 
-    for(auto market_update = snapshot_md_updates->getNextToRead(); snapshot_md_updates->size() &&  market_update; 
-        market_update = snapshot_md_updates->getNextToRead()) { 
-      logger.log("%:% %() % Processing %\n", 
-        __FILE__, __LINE__, __FUNCTION__, 
-        getCurrentTimeStr(&time_str),
-        market_update->toString().c_str()
-      );    
-      addToSnapshot(market_update);
-      snapshot_md_updates->updateReadIndex();      
-    }
-    if(getCurrentNanos() - last_snapshot_time > 60 * NANOS_TO_SECS) { 
+    // a new capture is only asked for once the previous snapshot is fully out 
+    if(!is_capture_requested && !isSnapshotPending() && getCurrentNanos() - last_snapshot_time >= config.snapshot_interval) { 
       last_snapshot_time = getCurrentNanos(); 
+      book_snapshot->request(); 
+      is_capture_requested = true; 
+    }
+    if(is_capture_requested && book_snapshot->isCaptured()) { 
+      is_capture_requested = false; 
       publishSnapshot(); 
     }
+    sendSnapshots(); 
   }
  }
 }
\ No newline at end of file
@@ -1,22 +1,48 @@
 #pragma once 
 
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+
 #include "common/Types.hpp"
 #include "common/ThreadUtil.hpp"
 #include "common/LockFreeQueue.hpp"
 #include "common/Macros.hpp"
 #include "common/McastSocket.hpp"
-#include "common/Mempool.hpp"
 #include "common/Logging.hpp"
 #include "MarketUpdate.hpp" 
-#include "exchange/matching/Order.hpp"
+#include "MarketDataChannel.hpp"
+#include "MDPPacketWriter.hpp"
+#include "exchange/matching/BookSnapshot.hpp"
 
 using namespace Common; 
 
 namespace Exchange { 
+   struct SnapshotSynthesizerConfig { 
+     // Time between the starts of consecutive snapshots, 0 starts the next one as soon as the last 
+     // one has gone out so the snapshot streams cycle through the book continuously 
+     Nanos snapshot_interval = 60 * NANOS_TO_SECS; 
+     // Bytes per second the snapshot streams of all channels may put on the wire together, 0 for no limit. A 
+     // snapshot is captured at once and then sent out a few packets at a time within this budget. 
+     size_t max_bytes_per_sec = 0; 
+
+     auto toString() const { 
+       std::stringstream ss; 
+       ss << "SnapshotSynthesizerCfg{" 
+          << "interval:" << snapshot_interval << "ns " 
+          << "max-bytes-per-sec:" << max_bytes_per_sec << "}"; 
+       return ss.str(); 
+     }
+   }; 
+
+   // Asks the matching engine for a copy of its books every snapshot interval and publishes each channel's 
+   // tickers from it on that channel's snapshot streams 
    class SnapshotSynthesizer { 
     public: 
-      SnapshotSynthesizer(MDPMarketUpdateLFQueue *market_updates, const std::string &iface, 
-         const std::string &snapshot_ip, int snapshot_port); 
+      SnapshotSynthesizer(MatchingEngineBookSnapshot *book_snapshot, const std::string &iface, 
+         const MarketDataChannelConfigs &channels, size_t mtu, 
+         const SnapshotSynthesizerConfig &config); 
              
       ~SnapshotSynthesizer () noexcept;
 
@@ -26,10 +52,19 @@ namespace Exchange {
 
       auto run() noexcept -> void; 
     
+      // Build the snapshot streams of every channel from the captured books, sendSnapshots() then puts them on the wire 
       auto publishSnapshot() noexcept -> void; 
 
-      auto addToSnapshot(const MDPMarketUpdate *market_update) noexcept -> void; 
-      
+      // Send as much of the captured snapshots as the bandwidth budget allows 
+      auto sendSnapshots() noexcept -> void; 
+
+      auto isSnapshotPending() const noexcept { 
+        return std::any_of(channels.begin(), channels.end(), [](const auto &channel) { 
+          return channel->next_snapshot_msg < channel->snapshot_msgs.size() || 
+                 channel->next_mbp_snapshot_msg < channel->mbp_snapshot_msgs.size(); 
+        }); 
+      }
+
 
       SnapshotSynthesizer () = delete; 
       SnapshotSynthesizer(const SnapshotSynthesizer &)  = delete; 
@@ -37,22 +72,55 @@ namespace Exchange {
       SnapshotSynthesizer &operator = (const SnapshotSynthesizer &)  = delete; 
       SnapshotSynthesizer &operator = (const SnapshotSynthesizer &&) = delete; 
     private : 
-      // Lock free queue containing incremental market data updates  
-      MDPMarketUpdateLFQueue *snapshot_md_updates = nullptr; 
       Logger logger;
+      const SnapshotSynthesizerConfig config; 
       volatile bool is_running = false; 
 
       std::string time_str; 
 
-      // Multicast socket for the snapshot multicast stream 
-      McastSocket snapshot_socket; 
+      // Books captured by the matching engine thread, read here only between request() and the next request() 
+      MatchingEngineBookSnapshot *book_snapshot = nullptr; 
+      bool is_capture_requested = false; 
+
+      // Snapshot streams of one market data channel and the snapshots built for them 
+      struct SnapshotChannel { 
+        const std::vector<TickerID> tickers; 
+
+        // Multicast socket for the snapshot multicast stream 
+        McastSocket snapshot_socket; 
+        MDPPacketWriter snapshot_packet_writer; 
+
+        // Multicast socket for the market by price snapshot stream 
+        McastSocket mbp_snapshot_socket; 
+        MDPPacketWriter mbp_snapshot_packet_writer; 
+
+        // Captured snapshots indexed by snapshot sequence number and the next message of each to send 
+        std::vector<MDPMarketUpdate> snapshot_msgs, mbp_snapshot_msgs; 
+        size_t next_snapshot_msg = 0, next_mbp_snapshot_msg = 0; 
+
+        SnapshotChannel(Logger &logger, size_t mtu, const MarketDataChannelConfig &channel_config) : 
+          tickers(channel_config.tickers), 
+          snapshot_socket(logger), 
+          snapshot_packet_writer(&snapshot_socket, mtu), 
+          mbp_snapshot_socket(logger), 
+          mbp_snapshot_packet_writer(&mbp_snapshot_socket, mtu) {} 
+      }; 
+      std::vector<std::unique_ptr<SnapshotChannel>> channels; 
       
-      // Hashmap that maps TickerID -> the order book snapshots 
-      std::array<std::array<MatchingEngineMarketUpdate*, MATCHING_ENGINE_MAX_ORDER_IDS>, MATCHING_ENGINE_MAX_TICKERS> ticker_orders; 
-      size_t last_increment_sequence_number = 0; 
+      // Bytes the snapshot streams may still send, refilled at config.max_bytes_per_sec 
+      double send_allowance = 0; 
+      Nanos  last_allowance_time = 0; 
+
       Nanos  last_snapshot_time = 0; 
-      
-      // Mempool used to manage update messages for the orders in the snapshot limit order books. 
-      MemPool<MatchingEngineMarketUpdate> order_pool; 
+
+      // Build the channel's order by order snapshot stream 
+      auto publishOrderSnapshot(SnapshotChannel &channel) noexcept -> void; 
+
+      // Build the channel's market by price snapshot stream 
+      auto publishPriceLevelSnapshot(SnapshotChannel &channel) noexcept -> void; 
+
+      // Send captured messages from next_msg on until they run out or the allowance is spent 
+      auto sendMessages(const std::vector<MDPMarketUpdate> &msgs, size_t &next_msg, 
+                        McastSocket &socket, MDPPacketWriter &packet_writer) noexcept -> void; 
    };
 }
\ No newline at end of file
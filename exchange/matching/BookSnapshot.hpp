@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "common/Types.hpp"
+#include "market_data/MarketUpdate.hpp"
+
+namespace Exchange {
+// Copy of every book of the matching engine. Each book is copied between two
+// client requests, so it is consistent with the market updates sent for its
+// ticker so far, which its sequence numbers record. Books of different tickers
+// may be copied on different passes of the matching engine loop. A reader asks
+// for a capture with request(), the matching engine thread fills in the
+// tickers and bumps the version, and the reader owns the contents until its
+// next request(). Only one reader is supported.
+class MatchingEngineBookSnapshot final {
+public:
+  struct TickerSnapshot {
+    // Ticker sequence numbers of the last update sent for the ticker on the
+    // incremental and on the market by price incremental stream
+    size_t last_sequence_number = 0;
+    size_t last_mbp_sequence_number = 0;
+    // Live orders as ADD updates, bids best price first then asks, in priority
+    // order within each level
+    std::vector<MatchingEngineMarketUpdate> orders;
+    // Every level as a PRICE_LEVEL update, in the same order
+    std::vector<MatchingEngineMarketUpdate> price_levels;
+  };
+
+  // Room for every order and level a book can hold, so capturing never
+  // allocates on the matching engine thread
+  MatchingEngineBookSnapshot() {
+    for (auto& ticker : tickers) {
+      ticker.orders.reserve(MATCHING_ENGINE_MAX_ORDER_IDS);
+      ticker.price_levels.reserve(MATCHING_ENGINE_MAX_PRICE_LEVELS);
+    }
+  }
+
+  MatchingEngineBookSnapshot(const MatchingEngineBookSnapshot&) = delete;
+  MatchingEngineBookSnapshot(const MatchingEngineBookSnapshot&&) = delete;
+  MatchingEngineBookSnapshot& operator=(const MatchingEngineBookSnapshot&) = delete;
+  MatchingEngineBookSnapshot& operator=(const MatchingEngineBookSnapshot&&) = delete;
+
+  // Reader side, tickers must not be read from here until isCaptured()
+  auto request() noexcept -> void {
+    requested_version.store(captured_version.load(std::memory_order_acquire) + 1,
+                            std::memory_order_release);
+  }
+
+  auto isCaptured() const noexcept {
+    return captured_version.load(std::memory_order_acquire) ==
+           requested_version.load(std::memory_order_relaxed);
+  }
+
+  // Matching engine side, checked once per pass of its loop
+  auto isRequested() const noexcept {
+    return requested_version.load(std::memory_order_acquire) !=
+           captured_version.load(std::memory_order_relaxed);
+  }
+
+  auto markCaptured() noexcept -> void {
+    captured_version.store(requested_version.load(std::memory_order_relaxed),
+                           std::memory_order_release);
+  }
+
+  auto version() const noexcept {
+    return captured_version.load(std::memory_order_acquire);
+  }
+
+  std::array<TickerSnapshot, MATCHING_ENGINE_MAX_TICKERS> tickers;
+
+private:
+  std::atomic<size_t> requested_version = 0;
+  std::atomic<size_t> captured_version = 0;
+};
+}  // namespace Exchange
@@ -4,13 +4,17 @@ namespace Exchange {
 
 MatchingEngine::MatchingEngine(ClientRequestLFQueue* client_request,
                                ClientResponseLFQueue* client_response,
-                               MarketUpdateLFQueue* market_updates)
+                               MarketUpdateLFQueue* market_updates,
+                               SelfTradePrevention self_trade_prevention,
+                               size_t price_level_depth)
     : incoming_requests(client_request),
       outgoing_responses(client_response),
       outgoing_market_updates(market_updates),
       logger("exchange_matching_engine.log") {
   for (__uint32_t i = 0; i < ticker_order_book.size(); i++) {
-    ticker_order_book[i] = new MatchingEngineOrderBook(i, &logger, this);
+    ticker_order_book[i] = new MatchingEngineOrderBook(i, &logger, this,
+                                                 self_trade_prevention,
+                                                 price_level_depth);
   }
 }
 MatchingEngine::~MatchingEngine() {
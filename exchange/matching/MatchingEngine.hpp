@@ -12,11 +12,21 @@ class MatchingEngine final {
 public:
   MatchingEngine(ClientRequestLFQueue* client_requests,
                  ClientResponseLFQueue* client_responses,
-                 MarketUpdateLFQueue* market_updates);
+                 MarketUpdateLFQueue* market_updates,
+                 SelfTradePrevention self_trade_prevention,
+                 size_t price_level_depth);
   ~MatchingEngine();
   auto start() -> void;
   auto stop() -> void;
 
+  // Best levels of a ticker's book, readable from any thread
+  auto depthView(TickerID ticker_id) const noexcept {
+    return ticker_order_book.at(ticker_id)->depthView();
+  }
+
+  // Books captured for the snapshot streams, see MatchingEngineBookSnapshot
+  auto bookSnapshot() noexcept { return &book_snapshot; }
+
   MatchingEngine() = delete;
   MatchingEngine(const MatchingEngine&) = delete;
   MatchingEngine(const MatchingEngine&&) = delete;
@@ -67,6 +77,24 @@ public:
     auto next_write = outgoing_market_updates->getNextToWrite();
     (*next_write) = *market_updates;
     outgoing_market_updates->updateWriteIndex();
+    // the publisher numbers each ticker's updates per stream the same way
+    ++(market_updates->type == MarketUpdateType::PRICE_LEVEL ?
+       ticker_last_mbp_sequence_number : ticker_last_sequence_number).at(market_updates->ticker_id);
+  }
+
+  // Copy one book per call, so a pass of the loop never stalls on more than
+  // one book, and mark the snapshot captured once every book is copied
+  auto captureBookSnapshot() noexcept -> void {
+    const auto ticker_id = next_snapshot_ticker_id;
+    auto& ticker_snapshot = book_snapshot.tickers[ticker_id];
+    ticker_snapshot.last_sequence_number = ticker_last_sequence_number[ticker_id];
+    ticker_snapshot.last_mbp_sequence_number = ticker_last_mbp_sequence_number[ticker_id];
+    ticker_order_book[ticker_id]->captureSnapshot(ticker_snapshot);
+    if (++next_snapshot_ticker_id < ticker_order_book.size()) { return; }
+    next_snapshot_ticker_id = 0;
+    book_snapshot.markCaptured();
+    logger.log("%:% %() % Captured book snapshot version:%\n", __FILE__, __LINE__, __FUNCTION__,
+               Common::getCurrentTimeStr(&time_str), book_snapshot.version());
   }
 
   auto run() noexcept -> void {
@@ -81,6 +109,9 @@ public:
         processClientRequest(client_request);
         incoming_requests->updateReadIndex();
       }
+      if (UNLIKELY(book_snapshot.isRequested())) {
+        captureBookSnapshot();
+      }
     }
   }
 private:
@@ -89,6 +120,15 @@ private:
   ClientResponseLFQueue* outgoing_responses = nullptr;
   MarketUpdateLFQueue* outgoing_market_updates = nullptr;
 
+  // Ticker sequence numbers of the last update sent for each ticker on the
+  // incremental and market by price incremental streams
+  std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> ticker_last_sequence_number{};
+  std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> ticker_last_mbp_sequence_number{};
+
+  MatchingEngineBookSnapshot book_snapshot;
+  // Next book captureBookSnapshot() copies
+  size_t next_snapshot_ticker_id = 0;
+
   volatile bool is_running = false;  // accessed by different threads
   std::string time_str;
   Logger logger;
@@ -46,6 +46,10 @@ struct MatchingEngineOrderAtPrice {
   Price price = PRICE_INVALID;
 
   MatchingEngineOrder* first_order = nullptr; 
+
+  // Total resting quantity and number of orders at the level, kept up to date for the market by price feed
+  Quantity quantity = 0;
+  Priority num_orders = 0;
   
   MatchingEngineOrderAtPrice* prev_entry = nullptr;
   MatchingEngineOrderAtPrice* next_entry = nullptr;
@@ -66,6 +70,8 @@ struct MatchingEngineOrderAtPrice {
     std::stringstream ss;
     ss << "MatchingEngineOrdersAtPrice[" << "side:" << sideToString(side) << " "
        << "price:" << priceToString(price) << " "
+       << "qty:" << quantityToString(quantity) << " "
+       << "orders:" << num_orders << " "
        << "first_me_order:"
        << (first_order ? first_order->toString() : "null") << " "
        << "prev:"
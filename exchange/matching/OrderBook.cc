@@ -5,12 +5,17 @@
 namespace Exchange {
 
 MatchingEngineOrderBook::MatchingEngineOrderBook(
-    TickerID ticker_id_, Logger* logger_, MatchingEngine* matching_engine_)
+    TickerID ticker_id_, Logger* logger_, MatchingEngine* matching_engine_,
+    SelfTradePrevention self_trade_prevention_, size_t price_level_depth_)
     : ticker_id(ticker_id_),
       logger(logger_),
       matching_engine(matching_engine_),
+      self_trade_prevention(self_trade_prevention_),
+      price_level_depth(price_level_depth_),
       orders_at_price_pool(MATCHING_ENGINE_MAX_PRICE_LEVELS),
-      order_pool(MATCHING_ENGINE_MAX_ORDER_IDS) {}
+      order_pool(MATCHING_ENGINE_MAX_ORDER_IDS) {
+  depth_view.write([this](BookDepth& depth) { depth.ticker_id = ticker_id; });
+}
 
 MatchingEngineOrderBook::~MatchingEngineOrderBook() {
   logger->log("%:% %() % OrderBook\n%\n", __FILE__, __LINE__, __FUNCTION__,
@@ -21,15 +26,23 @@ MatchingEngineOrderBook::~MatchingEngineOrderBook() {
 }
 
 auto MatchingEngineOrderBook::match(TickerID ticker_id_, ClientID client_id,
-                                    Side side, OrderID client_order_id,
+                                    Side side, Price price,
+                                    OrderID client_order_id,
                                     OrderID new_market_order_id,
                                     MatchingEngineOrder* itr,
                                     Quantity* leaves_quantity) noexcept {
   auto order = itr;
+  if (UNLIKELY(order->client_id == client_id) &&
+      self_trade_prevention != SelfTradePrevention::NONE) {
+    preventSelfTrade(ticker_id_, client_id, side, price, client_order_id,
+                     new_market_order_id, order, leaves_quantity);
+    return;
+  }
   const auto order_quantity = order->quantity;
   const auto fill_quantity = std::min(order_quantity, *leaves_quantity);
   (*leaves_quantity) -= fill_quantity;
   order->quantity -= fill_quantity;
+  getOrdersAtPrice(order->price)->quantity -= fill_quantity;
   client_response = {
       ClientResponseType::FILLED, client_id, ticker_id_,  client_order_id,
       new_market_order_id,        side,      itr->price, fill_quantity,
@@ -68,6 +81,172 @@ auto MatchingEngineOrderBook::match(TickerID ticker_id_, ClientID client_id,
                      order->priority};
     matching_engine->sendMarketUpdate(&market_update);
   }
+  onLevelChange(market_update.side, market_update.price);
+}
+
+auto MatchingEngineOrderBook::preventSelfTrade(
+    TickerID ticker_id_, ClientID client_id, Side side, Price price,
+    OrderID client_order_id, OrderID new_market_order_id,
+    MatchingEngineOrder* order, Quantity* leaves_quantity) noexcept -> void {
+  logger->log("%:% %() % Self trade % cid:% oid:% against %\n", __FILE__,
+              __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+              selfTradePreventionToString(self_trade_prevention), client_id,
+              client_order_id, order->toString());
+  // Quantity removed from the resting order, the aggressor always loses at
+  // least as much so the loop in checkForMatch() makes progress.
+  Quantity resting_decrement = 0;
+  switch (self_trade_prevention) {
+  case SelfTradePrevention::CANCEL_RESTING:
+    resting_decrement = order->quantity;
+    break;
+  case SelfTradePrevention::CANCEL_AGGRESSOR: {
+    client_response = {ClientResponseType::CANCELLED,
+                       client_id,
+                       ticker_id_,
+                       client_order_id,
+                       new_market_order_id,
+                       side,
+                       price,
+                       QUANTITY_INVALID,
+                       (*leaves_quantity)};
+    matching_engine->sendClientResponse(&client_response);
+    (*leaves_quantity) = 0;
+  } break;
+  case SelfTradePrevention::DECREMENT_BOTH: {
+    resting_decrement = std::min(order->quantity, *leaves_quantity);
+    (*leaves_quantity) -= resting_decrement;
+    client_response = {(*leaves_quantity) ? ClientResponseType::DECREMENTED
+                                          : ClientResponseType::CANCELLED,
+                       client_id,
+                       ticker_id_,
+                       client_order_id,
+                       new_market_order_id,
+                       side,
+                       price,
+                       resting_decrement,
+                       (*leaves_quantity)};
+    matching_engine->sendClientResponse(&client_response);
+  } break;
+  case SelfTradePrevention::NONE:
+    break;
+  }
+  if (!resting_decrement) { return; }
+
+  order->quantity -= resting_decrement;
+  getOrdersAtPrice(order->price)->quantity -= resting_decrement;
+  client_response = {order->quantity ? ClientResponseType::DECREMENTED
+                                     : ClientResponseType::CANCELLED,
+                     order->client_id,
+                     ticker_id_,
+                     order->client_order_id,
+                     order->market_order_id,
+                     order->side,
+                     order->price,
+                     resting_decrement,
+                     order->quantity};
+  matching_engine->sendClientResponse(&client_response);
+  if (!order->quantity) {
+    market_update = {MarketUpdateType::CANCEL,
+                     order->market_order_id,
+                     ticker_id_,
+                     order->side,
+                     order->price,
+                     0,
+                     order->priority};
+    removeOrder(order);
+  } else {
+    market_update = {MarketUpdateType::MODIFY,
+                     order->market_order_id,
+                     ticker_id_,
+                     order->side,
+                     order->price,
+                     order->quantity,
+                     order->priority};
+  }
+  matching_engine->sendMarketUpdate(&market_update);
+  onLevelChange(market_update.side, market_update.price);
+}
+
+auto MatchingEngineOrderBook::captureSnapshot(
+    MatchingEngineBookSnapshot::TickerSnapshot& snapshot) const noexcept -> void {
+  snapshot.orders.clear();
+  snapshot.price_levels.clear();
+  for (const auto best_orders_by_price : {bids_by_price, asks_by_price}) {
+    for (auto level = best_orders_by_price; level;
+         level = (level->next_entry == best_orders_by_price ? nullptr : level->next_entry)) {
+      snapshot.price_levels.push_back({MarketUpdateType::PRICE_LEVEL, ORDER_ID_INVALID, ticker_id, level->side,
+                                       level->price, level->quantity, level->num_orders});
+      auto order = level->first_order;
+      do {
+        snapshot.orders.push_back({MarketUpdateType::ADD, order->market_order_id, ticker_id, order->side,
+                                   order->price, order->quantity, order->priority});
+        order = order->next_order;
+      } while (order != level->first_order);
+    }
+  }
+}
+
+auto MatchingEngineOrderBook::publishDepth(Side side, Price price) noexcept -> void {
+  const auto best_orders_by_price = (side == Side::BUY ? bids_by_price : asks_by_price);
+  const auto next_level = [best_orders_by_price](const MatchingEngineOrderAtPrice* level) {
+    return (level->next_entry == best_orders_by_price ? nullptr : level->next_entry);
+  };
+  // a change behind the last visible level leaves the view as it is
+  auto last_level = best_orders_by_price;
+  for (size_t depth = 1; last_level && depth < BOOK_DEPTH_LEVELS; ++depth) {
+    last_level = next_level(last_level);
+  }
+  if (last_level && (side == Side::BUY ? price < last_level->price : price > last_level->price)) { return; }
+
+  depth_view.write([&](BookDepth& depth) {
+    auto& levels = depth.levels[sideToIndex(side)];
+    uint32_t num_levels = 0;
+    for (auto level = best_orders_by_price; level && num_levels < BOOK_DEPTH_LEVELS;
+         level = next_level(level), ++num_levels) {
+      levels[num_levels] = {level->price, level->quantity, static_cast<uint32_t>(level->num_orders)};
+    }
+    depth.num_levels[sideToIndex(side)] = num_levels;
+    depth.updateDerived();
+  });
+}
+
+auto MatchingEngineOrderBook::sendPriceLevelUpdate(Side side, Price price) noexcept -> void {
+  if (!price_level_depth) { return; }
+  const auto best_orders_by_price = (side == Side::BUY ? bids_by_price : asks_by_price);
+  const auto next_level = [best_orders_by_price](const MatchingEngineOrderAtPrice* level) {
+    return (level->next_entry == best_orders_by_price ? nullptr : level->next_entry);
+  };
+  // the levels ahead of this price are the same whether or not it is still in the book
+  size_t depth = 0;
+  auto level = best_orders_by_price;
+  for (; level && depth < price_level_depth &&
+         (side == Side::BUY ? level->price > price : level->price < price);
+       ++depth) {
+    level = next_level(level);
+  }
+  if (depth == price_level_depth) { return; }
+
+  const auto orders_at_price = getOrdersAtPrice(price);
+  const bool is_removed = (!orders_at_price || orders_at_price->side != side || orders_at_price->price != price);
+  market_update = {MarketUpdateType::PRICE_LEVEL,
+                   ORDER_ID_INVALID,
+                   ticker_id,
+                   side,
+                   price,
+                   is_removed ? 0 : orders_at_price->quantity,
+                   is_removed ? 0 : orders_at_price->num_orders};
+  matching_engine->sendMarketUpdate(&market_update);
+  if (!is_removed) { return; }
+
+  // level is the one that followed the removed level, walk it to the last visible depth
+  for (; level && depth + 1 < price_level_depth; ++depth) {
+    level = next_level(level);
+  }
+  if (level) {
+    market_update = {MarketUpdateType::PRICE_LEVEL, ORDER_ID_INVALID, ticker_id, side,
+                     level->price, level->quantity, level->num_orders};
+    matching_engine->sendMarketUpdate(&market_update);
+  }
 }
 
 auto MatchingEngineOrderBook::checkForMatch(
@@ -78,16 +257,16 @@ auto MatchingEngineOrderBook::checkForMatch(
     while (leaves_quantity && asks_by_price) {
       const auto ask_itr = asks_by_price->first_order;
       if (LIKELY(price < ask_itr->price)) { break; }
-      match(ticker_id_, client_id, side, client_order_id, new_market_order_id,
-            ask_itr, &leaves_quantity);
+      match(ticker_id_, client_id, side, price, client_order_id,
+            new_market_order_id, ask_itr, &leaves_quantity);
     }
   }
   if (side == Side::SELL) {
     while (leaves_quantity && bids_by_price) {
       const auto bid_itr = bids_by_price->first_order;
       if (LIKELY(price > bid_itr->price)) { break; }
-      match(ticker_id_, client_id, side, client_order_id, new_market_order_id,
-            bid_itr, &leaves_quantity);
+      match(ticker_id_, client_id, side, price, client_order_id,
+            new_market_order_id, bid_itr, &leaves_quantity);
     }
   }
   return leaves_quantity;
@@ -98,8 +277,8 @@ auto MatchingEngineOrderBook::add(ClientID client_id, OrderID client_order_id,
                                   Quantity quantity) noexcept -> void {
   const auto new_market_order_id = generateNewMarketOrderId();
   client_response = {ClientResponseType::ACCEPTED,
-                     ticker_id_,
                      client_id,
+                     ticker_id_,
                      client_order_id,
                      new_market_order_id,
                      side,
@@ -131,6 +310,7 @@ auto MatchingEngineOrderBook::add(ClientID client_id, OrderID client_order_id,
                      leaves_quantity,
                      priority};
     matching_engine->sendMarketUpdate(&market_update);
+    onLevelChange(side, price);
   }
 }
 
@@ -171,6 +351,7 @@ auto MatchingEngineOrderBook::cancel(ClientID client_id, OrderID order_id,
     };
     removeOrder(exchange_order);
     matching_engine->sendMarketUpdate(&market_update);
+    onLevelChange(market_update.side, market_update.price);
   }
   matching_engine->sendClientResponse(&client_response);
 }
@@ -236,7 +417,7 @@ auto MatchingEngineOrderBook::toString(bool detailed, bool validity_check) const
   
   {
     auto bid_itr = bids_by_price; 
-    auto last_bid_price = std::numeric_limits<Price>::min(); 
+    auto last_bid_price = std::numeric_limits<Price>::max(); 
     for(size_t count = 0; bid_itr; count++) { 
      ss << "BIDS L : " << count << " => "; 
      auto next_bid_itr = (bid_itr->next_entry == bids_by_price ? nullptr : bid_itr->next_entry); 
@@ -1,5 +1,7 @@
 #pragma once
+#include "BookSnapshot.hpp"
 #include "Order.hpp"
+#include "common/BookDepth.hpp"
 #include "common/Logging.hpp"
 #include "common/Mempool.hpp"
 #include "common/Types.hpp"
@@ -10,11 +12,39 @@
 using namespace Common;
 
 namespace Exchange {
+// Action taken when an incoming order would trade against a resting order
+// of the same client
+enum class SelfTradePrevention : uint8_t {
+  NONE = 0,              // allow the self trade
+  CANCEL_RESTING = 1,    // cancel the resting order, keep matching
+  CANCEL_AGGRESSOR = 2,  // cancel the remaining incoming quantity
+  DECREMENT_BOTH = 3     // reduce both orders by the overlap, no trade
+};
+
+inline auto selfTradePreventionToString(SelfTradePrevention stp)
+    -> std::string {
+  switch (stp) {
+  case SelfTradePrevention::NONE:
+    return "NONE";
+  case SelfTradePrevention::CANCEL_RESTING:
+    return "CANCEL_RESTING";
+  case SelfTradePrevention::CANCEL_AGGRESSOR:
+    return "CANCEL_AGGRESSOR";
+  case SelfTradePrevention::DECREMENT_BOTH:
+    return "DECREMENT_BOTH";
+  }
+  return "UNKNOWN";
+}
+
 class MatchingEngine;
 class MatchingEngineOrderBook final {
 public:
+  // price_level_depth is the number of best levels per side published on the
+  // market by price feed, 0 publishes none
   explicit MatchingEngineOrderBook(TickerID ticket_id_, Logger* logger_,
-                                   MatchingEngine* matching_engine_);
+                                   MatchingEngine* matching_engine_,
+                                   SelfTradePrevention self_trade_prevention_,
+                                   size_t price_level_depth_);
 
   ~MatchingEngineOrderBook();
 
@@ -23,6 +53,12 @@ public:
 
   auto cancel(ClientID client_id, OrderID order_id, TickerID ticker_id) noexcept -> void;
 
+  // Best levels of the book, kept current for readers on other threads
+  auto depthView() const noexcept -> const BookDepthView* { return &depth_view; }
+
+  // Copy the live orders and levels into snapshot, leaves its sequence numbers alone
+  auto captureSnapshot(MatchingEngineBookSnapshot::TickerSnapshot& snapshot) const noexcept -> void;
+
   auto toString(bool detailed, bool validity_check) const -> std::string;
 
   MatchingEngineOrderBook() = delete;
@@ -40,6 +76,10 @@ private:
 
   MatchingEngine* matching_engine = nullptr;
 
+  const SelfTradePrevention self_trade_prevention = SelfTradePrevention::NONE;
+
+  const size_t price_level_depth = 0;
+
   ClientOrderHashMap cid_oid_to_order;
 
   MemPool<MatchingEngineOrderAtPrice> orders_at_price_pool;
@@ -56,6 +96,8 @@ private:
 
   OrderID next_market_order_id = 1;
 
+  BookDepthView depth_view;
+
   std::string time_str;
 
 private:
@@ -78,10 +120,33 @@ private:
     return orders_at_price->first_order->prev_order->priority + 1;
   }
 
-  auto match(TickerID ticker_id_, ClientID client_id, Side side,
+  auto match(TickerID ticker_id_, ClientID client_id, Side side, Price price,
              OrderID client_order_id, OrderID new_market_order_id,
              MatchingEngineOrder* itr, Quantity* leaves_quantity) noexcept;
 
+  // Slow path of match() taken only when both orders belong to the same
+  // client, price is the aggressor's limit price its responses report
+  auto preventSelfTrade(TickerID ticker_id_, ClientID client_id, Side side,
+                        Price price, OrderID client_order_id,
+                        OrderID new_market_order_id,
+                        MatchingEngineOrder* order,
+                        Quantity* leaves_quantity) noexcept -> void;
+
+  // Publish the aggregated state of a level that changed as a PRICE_LEVEL
+  // update if it is among the best price_level_depth levels of its side, with
+  // quantity 0 once it is gone. A level moving up into view because this one
+  // emptied is published too, consumers drop levels pushed out of view.
+  auto sendPriceLevelUpdate(Side side, Price price) noexcept -> void;
+
+  // Rewrite the side of depth_view if the changed level is among its levels
+  auto publishDepth(Side side, Price price) noexcept -> void;
+
+  // Every change to the quantity or orders of a level ends up here
+  auto onLevelChange(Side side, Price price) noexcept {
+    sendPriceLevelUpdate(side, price);
+    publishDepth(side, price);
+  }
+
   auto checkForMatch(ClientID client_id, OrderID client_order_id,
                      TickerID ticker_id_, Side side, Price price,
                      Quantity quantity, OrderID new_market_order_id) noexcept -> Quantity;
@@ -107,6 +172,8 @@ private:
 
   auto removeOrder(MatchingEngineOrder* order) noexcept {
     auto order_at_price = getOrdersAtPrice(order->price);
+    order_at_price->quantity -= order->quantity;
+    --order_at_price->num_orders;
     if (order->prev_order == order) {  // only one element in the list
       removeOrderAtPrice(order->side, order->price);
     } else {
@@ -186,12 +253,12 @@ private:
   }
 
   auto addOrder(MatchingEngineOrder* order) noexcept {
-    const auto orders_at_price = getOrdersAtPrice(order->price);
+    auto orders_at_price = getOrdersAtPrice(order->price);
     if (!orders_at_price) {
       order->next_order = order->prev_order = order;
-      auto new_orders_at_price = orders_at_price_pool.allocate(
+      orders_at_price = orders_at_price_pool.allocate(
           order->side, order->price, order, nullptr, nullptr);
-      addOrderAtPrice(new_orders_at_price);
+      addOrderAtPrice(orders_at_price);
     } else {
       auto first_order = orders_at_price->first_order;
       first_order->prev_order->next_order = order;
@@ -199,6 +266,8 @@ private:
       order->next_order = first_order;
       first_order->prev_order = order;
     }
+    orders_at_price->quantity += order->quantity;
+    ++orders_at_price->num_orders;
     cid_oid_to_order.at(order->client_id).at(order->client_order_id) = order;
   }
 };
@@ -49,20 +49,6 @@ struct MatchingEngineClientRequest {
   }
 };
 
-// Used by market participants to send order requests to exchange gateway server 
-struct OrderManagementClientRequest { 
-  size_t sequence_number = 0;
-  MatchingEngineClientRequest me_client_request; 
-  auto toString() const {
-    std::stringstream ss;
-    ss << "OrderManagementClientRequest"
-       << " ["
-       << "seq:" << sequence_number
-       << " " << me_client_request.toString()
-       << "]";
-    return ss.str();
-  }
-}; 
 #pragma pack(pop)
 typedef LockFreeQueue<MatchingEngineClientRequest> ClientRequestLFQueue;
 }  // namespace Exchange
\ No newline at end of file
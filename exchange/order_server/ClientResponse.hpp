@@ -13,7 +13,9 @@ enum class ClientResponseType : uint8_t {
   ACCEPTED = 1,
   CANCELLED = 2,
   FILLED = 3,
-  CANCEL_REJECTED = 4
+  CANCEL_REJECTED = 4,
+  DECREMENTED = 5,
+  REJECTED = 6
 };
 inline std::string clientResponseTypeToString(ClientResponseType type) {
   switch (type) {
@@ -27,6 +29,10 @@ inline std::string clientResponseTypeToString(ClientResponseType type) {
     return "FILLED";
   case ClientResponseType::CANCEL_REJECTED:
     return "CANCEL_REJECTED";
+  case ClientResponseType::DECREMENTED:
+    return "DECREMENTED";
+  case ClientResponseType::REJECTED:
+    return "REJECTED";
   }
   return "UNKNOWN";
 }
@@ -59,20 +65,6 @@ struct MatchingEngineClientResponse {
   }
 };
 
-struct OrderManagementClientResponse { 
-  size_t sequence_number = 0; 
-  MatchingEngineClientResponse me_client_response; 
-  auto toString() const {
-    std::stringstream ss;
-    ss << "OrderManagementClientResponse"
-       << " ["
-       << "seq:" << sequence_number
-       << " " << me_client_response.toString()
-       << "]";
-    return ss.str();
-  }
-}; 
-
 #pragma pack(pop)
 typedef LockFreeQueue<MatchingEngineClientResponse> ClientResponseLFQueue;
 }  // namespace Exchange
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once 
+#include <algorithm>
 #include "common/ThreadUtil.hpp"
 #include "common/Macros.hpp"
 #include "common/TimeUtil.hpp"
@@ -9,26 +10,81 @@ namespace Exchange {
   class FIFOSequencer { 
    public : 
     FIFOSequencer(ClientRequestLFQueue *client_requests, Logger *logger_) : 
-        incoming_requests(client_requests), logger(logger_) { }
+        incoming_requests(client_requests), logger(logger_) {
+      for(size_t i = 0; i < free_indices.size(); i++) {
+        free_indices[i] = static_cast<uint32_t>(free_indices.size() - 1 - i);
+      }
+      free_size = free_indices.size();
+    }
     ~FIFOSequencer(){
 
     }
-    auto addClientRequest(Nanos rx_time, const MatchingEngineClientRequest &request) {
-     if(pending_size >= pending_client_requests.size()) { 
-      FATAL("Too many requests"); 
+
+    // Take a free staging slot for the caller to decode a request into, so the request is written 
+    // once here and copied once more into the matching engine queue. Publishes early when every 
+    // slot is taken, returns INVALID_INDEX when neither the staging area nor the matching engine 
+    // queue has room, the caller must then hold on to the request and retry later. 
+    auto reserve() noexcept -> uint32_t { 
+     if(UNLIKELY(!free_size)) {
+      logger->log("%:% %() % Staging full with % requests, publishing early.\n",
+        __FILE__, __LINE__, __FUNCTION__,
+        Common::getCurrentTimeStr(&time_str), pending_size);
+      sequenceAndPublish();
+      if(UNLIKELY(!free_size)) {
+       return INVALID_INDEX;
+      }
      }   
-     pending_client_requests.at(pending_size++) = std::move(RecvTimeClientRequest{rx_time, request}); 
+     return free_indices[--free_size];
+    } 
+
+    auto stagedRequest(uint32_t index) noexcept -> MatchingEngineClientRequest & { 
+     return pending_client_requests[index].request; 
+    }
+
+    // Give back a reserved slot whose request is not going to be sequenced 
+    auto release(uint32_t index) noexcept -> void { 
+     free_indices[free_size++] = index; 
+    }
+
+    // Stage the request decoded into a reserved slot at the tail of its client's stream. Requests 
+    // from one client arrive on one socket and are already in rx time order, so each stream stays 
+    // sorted without any work. 
+    auto addClientRequest(Nanos rx_time, uint32_t index) noexcept -> void {
+     auto &pending = pending_client_requests[index];
+     pending.recv_time = rx_time;
+     pending.next = INVALID_INDEX;
+     const auto client_id = pending.request.client_id; 
+     auto &stream = client_streams.at(client_id);
+     if(stream.head == INVALID_INDEX) {
+      stream.head = index;
+      heap[heap_size++] = client_id;
+      std::push_heap(heap.begin(), heap.begin() + heap_size,
+            [this](auto lhs, auto rhs) { return laterHead(lhs, rhs); });
+     } else {
+      pending_client_requests[stream.tail].next = index;
+     }
+     stream.tail = index;
+     ++pending_size;
     } 
 
-    auto sequenceAndPublish() { 
+    // Merge the per client streams by rx time into the matching engine queue, O(n log k) for n
+    // requests spread over k clients. Stops early if the matching engine queue is full, the
+    // requests held back stay staged for the next call.
+    auto sequenceAndPublish() noexcept -> void {
      if(UNLIKELY(!pending_size)) return; 
-      logger->log("%:% %() % Processing % requests.\n", 
+      logger->log("%:% %() % Processing % requests from % clients.\n",
         __FILE__, __LINE__, __FUNCTION__, 
-        Common::getCurrentTimeStr(&time_str), pending_size); 
-      std::sort(pending_client_requests.begin(), pending_client_requests.begin() + pending_size); 
+        Common::getCurrentTimeStr(&time_str), pending_size, heap_size);
       
-      for(size_t i = 0; i < pending_size; i++) { 
-        const auto &client_request = pending_client_requests.at(i); 
+      // LockFreeQueue treats read == write as empty, so one slot always stays unused
+      auto room = incoming_requests->capacity() - 1 - incoming_requests->size();
+      for(; heap_size && room; --room) {
+        std::pop_heap(heap.begin(), heap.begin() + heap_size,
+            [this](auto lhs, auto rhs) { return laterHead(lhs, rhs); });
+        const auto client_id = heap[--heap_size];
+        auto &stream = client_streams[client_id];
+        const auto index = stream.head;
+        const auto &client_request = pending_client_requests[index];
         logger->log("%:% %() % Writing RX:% Req:% to FIFO.\n", 
             __FILE__, __LINE__, __FUNCTION__, 
             Common::getCurrentTimeStr(&time_str),
@@ -36,10 +92,30 @@ namespace Exchange {
             client_request.request.toString()
         );
         auto next_write = incoming_requests->getNextToWrite(); 
-        (*next_write) = std::move(client_request.request); 
+        (*next_write) = client_request.request;
         incoming_requests->updateWriteIndex(); 
+
+        stream.head = client_request.next;
+        free_indices[free_size++] = index;
+        --pending_size;
+        if(stream.head != INVALID_INDEX) {
+          heap[heap_size++] = client_id;
+          std::push_heap(heap.begin(), heap.begin() + heap_size,
+            [this](auto lhs, auto rhs) { return laterHead(lhs, rhs); });
+        } else {
+          stream.tail = INVALID_INDEX;
+        }
+      }
+      if(UNLIKELY(pending_size)) {
+        logger->log("%:% %() % Matching engine queue full, holding % requests.\n",
+          __FILE__, __LINE__, __FUNCTION__,
+          Common::getCurrentTimeStr(&time_str), pending_size);
       }
-      pending_size = 0; 
+    }
+
+    // True when requests are staged and the matching engine queue has room for some of them 
+    auto canPublish() const noexcept { 
+     return pending_size && incoming_requests->size() + 1 < incoming_requests->capacity(); 
     }
 
     FIFOSequencer() = delete; 
@@ -48,6 +124,8 @@ namespace Exchange {
     FIFOSequencer &operator = (const FIFOSequencer &) = delete; 
     FIFOSequencer &operator = (const FIFOSequencer &&) = delete; 
 
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
    private:
     ClientRequestLFQueue *incoming_requests = nullptr; 
     std::string time_str; 
@@ -55,11 +133,28 @@ namespace Exchange {
     struct RecvTimeClientRequest { 
      Nanos recv_time = 0; 
      MatchingEngineClientRequest request; 
-     auto operator < (const RecvTimeClientRequest &rhs) const { 
-      return recv_time < rhs.recv_time; 
-     }
+     // next request from the same client, INVALID_INDEX at the tail
+     uint32_t next = INVALID_INDEX;
     };
+    // Slots shared by all clients, each client's pending requests are chained through `next`
     std::array<RecvTimeClientRequest, MATCHING_ENGINE_MAX_PENDING_REQUESTS> pending_client_requests; 
+    std::array<uint32_t, MATCHING_ENGINE_MAX_PENDING_REQUESTS> free_indices;
+    size_t free_size = 0;
     size_t pending_size = 0; 
+
+    struct ClientStream {
+     uint32_t head = INVALID_INDEX;
+     uint32_t tail = INVALID_INDEX;
+    };
+    std::array<ClientStream, MATCHING_ENGINE_MAX_NUM_CLIENTS> client_streams;
+
+    // Min-heap of clients with staged requests keyed on the rx time of their oldest request
+    std::array<ClientID, MATCHING_ENGINE_MAX_NUM_CLIENTS> heap;
+    size_t heap_size = 0;
+
+    auto laterHead(ClientID lhs, ClientID rhs) const noexcept -> bool {
+     return pending_client_requests[client_streams[lhs].head].recv_time >
+            pending_client_requests[client_streams[rhs].head].recv_time;
+    }
   }; 
 }
\ No newline at end of file
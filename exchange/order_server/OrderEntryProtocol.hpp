@@ -0,0 +1,271 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include "ClientRequest.hpp"
+#include "ClientResponse.hpp"
+#include "common/Macros.hpp"
+#include "common/Types.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+// Wire protocol between OrderGateway and OrderServer. Every frame starts with an
+// OrderEntryHeader giving its total length, the protocol version and the
+// message type. A session opens with a LOGON carrying the client id, later
+// messages in either direction leave the client id out. Ticker ids are sent as
+// one byte and client order ids as four, values that do not fit go out as the
+// narrow type's maximum and decode as invalid.
+constexpr uint8_t ORDER_ENTRY_PROTOCOL_VERSION = 1;
+
+static_assert(MATCHING_ENGINE_MAX_TICKERS < std::numeric_limits<uint8_t>::max());
+static_assert(MATCHING_ENGINE_MAX_ORDER_IDS < std::numeric_limits<uint32_t>::max());
+
+enum class OrderEntryMessageType : uint8_t {
+  INVALID = 0,
+  LOGON = 1,
+  NEW_ORDER = 2,
+  CANCEL_ORDER = 3,
+  EXECUTION_REPORT = 4
+};
+
+inline auto orderEntryMessageTypeToString(OrderEntryMessageType type)
+    -> std::string {
+  switch (type) {
+  case OrderEntryMessageType::INVALID:
+    return "INVALID";
+  case OrderEntryMessageType::LOGON:
+    return "LOGON";
+  case OrderEntryMessageType::NEW_ORDER:
+    return "NEW_ORDER";
+  case OrderEntryMessageType::CANCEL_ORDER:
+    return "CANCEL_ORDER";
+  case OrderEntryMessageType::EXECUTION_REPORT:
+    return "EXECUTION_REPORT";
+  }
+  return "UNKNOWN";
+}
+
+#pragma pack(push, 1)
+struct OrderEntryHeader {
+  uint16_t length = 0;
+  uint8_t version = ORDER_ENTRY_PROTOCOL_VERSION;
+  OrderEntryMessageType type = OrderEntryMessageType::INVALID;
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "OrderEntryHeader"
+       << " ["
+       << "len:" << length << " ver:" << static_cast<int>(version)
+       << " type:" << orderEntryMessageTypeToString(type) << "]";
+    return ss.str();
+  }
+};
+
+// Client -> server, binds the session to a client id
+struct OrderEntryLogon {
+  OrderEntryHeader header;
+  ClientID client_id = CLIENT_ID_INVALID;
+};
+
+// Client -> server
+struct OrderEntryNewOrder {
+  OrderEntryHeader header;
+  uint32_t sequence_number = 0;
+  uint8_t ticker_id = 0;
+  uint32_t order_id = 0;
+  Side side = Side::INVALID;
+  Price price = PRICE_INVALID;
+  Quantity quantity = QUANTITY_INVALID;
+};
+
+// Client -> server
+struct OrderEntryCancelOrder {
+  OrderEntryHeader header;
+  uint32_t sequence_number = 0;
+  uint8_t ticker_id = 0;
+  uint32_t order_id = 0;
+};
+
+// Server -> client, one per MatchingEngineClientResponse
+struct OrderEntryExecutionReport {
+  OrderEntryHeader header;
+  uint32_t sequence_number = 0;
+  ClientResponseType type = ClientResponseType::INVALID;
+  uint8_t ticker_id = 0;
+  uint32_t client_order_id = 0;
+  OrderID market_order_id = ORDER_ID_INVALID;
+  Side side = Side::INVALID;
+  Price price = PRICE_INVALID;
+  Quantity exec_quantity = QUANTITY_INVALID;
+  Quantity leaves_quantity = QUANTITY_INVALID;
+};
+#pragma pack(pop)
+
+// Largest frame in either direction
+constexpr size_t ORDER_ENTRY_MAX_MESSAGE_SIZE =
+    std::max({sizeof(OrderEntryLogon), sizeof(OrderEntryNewOrder),
+              sizeof(OrderEntryCancelOrder), sizeof(OrderEntryExecutionReport)});
+
+inline auto narrowTickerId(TickerID ticker_id) noexcept -> uint8_t {
+  return static_cast<uint8_t>(
+      std::min<TickerID>(ticker_id, std::numeric_limits<uint8_t>::max()));
+}
+
+inline auto widenTickerId(uint8_t ticker_id) noexcept -> TickerID {
+  return ticker_id == std::numeric_limits<uint8_t>::max() ? TICKER_ID_INVALID
+                                                          : ticker_id;
+}
+
+inline auto narrowOrderId(OrderID order_id) noexcept -> uint32_t {
+  return static_cast<uint32_t>(
+      std::min<OrderID>(order_id, std::numeric_limits<uint32_t>::max()));
+}
+
+inline auto widenOrderId(uint32_t order_id) noexcept -> OrderID {
+  return order_id == std::numeric_limits<uint32_t>::max() ? ORDER_ID_INVALID
+                                                          : order_id;
+}
+
+// Bytes of the frame starting at data once all of it has arrived, 0 while it
+// is incomplete. A header that cannot start a valid frame is reported through
+// is_corrupt, the stream cannot be resynchronised after that.
+inline auto orderEntryFrameSize(const char* data, size_t available,
+                                bool& is_corrupt) noexcept -> size_t {
+  is_corrupt = false;
+  if (available < sizeof(OrderEntryHeader)) { return 0; }
+  const auto header = reinterpret_cast<const OrderEntryHeader*>(data);
+  if (UNLIKELY(header->version != ORDER_ENTRY_PROTOCOL_VERSION ||
+               header->length < sizeof(OrderEntryHeader) ||
+               header->length > ORDER_ENTRY_MAX_MESSAGE_SIZE)) {
+    is_corrupt = true;
+    return 0;
+  }
+  return available >= header->length ? header->length : 0;
+}
+
+inline auto encodeLogon(ClientID client_id, char* out) noexcept -> size_t {
+  auto logon = reinterpret_cast<OrderEntryLogon*>(out);
+  logon->header = {sizeof(OrderEntryLogon), ORDER_ENTRY_PROTOCOL_VERSION,
+                   OrderEntryMessageType::LOGON};
+  logon->client_id = client_id;
+  return sizeof(OrderEntryLogon);
+}
+
+// Write request as a NEW_ORDER or CANCEL_ORDER frame, returns the frame size
+// or 0 for a request type the protocol cannot carry
+inline auto encodeClientRequest(uint32_t sequence_number,
+                                const MatchingEngineClientRequest& request,
+                                char* out) noexcept -> size_t {
+  switch (request.type) {
+  case ClientRequestType::NEW: {
+    auto new_order = reinterpret_cast<OrderEntryNewOrder*>(out);
+    new_order->header = {sizeof(OrderEntryNewOrder),
+                         ORDER_ENTRY_PROTOCOL_VERSION,
+                         OrderEntryMessageType::NEW_ORDER};
+    new_order->sequence_number = sequence_number;
+    new_order->ticker_id = narrowTickerId(request.ticker_id);
+    new_order->order_id = narrowOrderId(request.order_id);
+    new_order->side = request.side;
+    new_order->price = request.price;
+    new_order->quantity = request.quantity;
+    return sizeof(OrderEntryNewOrder);
+  }
+  case ClientRequestType::CANCEL: {
+    auto cancel_order = reinterpret_cast<OrderEntryCancelOrder*>(out);
+    cancel_order->header = {sizeof(OrderEntryCancelOrder),
+                            ORDER_ENTRY_PROTOCOL_VERSION,
+                            OrderEntryMessageType::CANCEL_ORDER};
+    cancel_order->sequence_number = sequence_number;
+    cancel_order->ticker_id = narrowTickerId(request.ticker_id);
+    cancel_order->order_id = narrowOrderId(request.order_id);
+    return sizeof(OrderEntryCancelOrder);
+  }
+  case ClientRequestType::INVALID:
+    break;
+  }
+  return 0;
+}
+
+// Read a complete NEW_ORDER or CANCEL_ORDER frame for the session's client,
+// returns false if the frame is of another type or too short for its type
+inline auto decodeClientRequest(const char* frame, ClientID client_id,
+                                uint32_t& sequence_number,
+                                MatchingEngineClientRequest& request) noexcept
+    -> bool {
+  const auto header = reinterpret_cast<const OrderEntryHeader*>(frame);
+  request = {};
+  request.client_id = client_id;
+  switch (header->type) {
+  case OrderEntryMessageType::NEW_ORDER: {
+    if (UNLIKELY(header->length < sizeof(OrderEntryNewOrder))) { return false; }
+    const auto new_order = reinterpret_cast<const OrderEntryNewOrder*>(frame);
+    sequence_number = new_order->sequence_number;
+    request.type = ClientRequestType::NEW;
+    request.ticker_id = widenTickerId(new_order->ticker_id);
+    request.order_id = widenOrderId(new_order->order_id);
+    request.side = new_order->side;
+    request.price = new_order->price;
+    request.quantity = new_order->quantity;
+    return true;
+  }
+  case OrderEntryMessageType::CANCEL_ORDER: {
+    if (UNLIKELY(header->length < sizeof(OrderEntryCancelOrder))) { return false; }
+    const auto cancel_order =
+        reinterpret_cast<const OrderEntryCancelOrder*>(frame);
+    sequence_number = cancel_order->sequence_number;
+    request.type = ClientRequestType::CANCEL;
+    request.ticker_id = widenTickerId(cancel_order->ticker_id);
+    request.order_id = widenOrderId(cancel_order->order_id);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+inline auto encodeClientResponse(uint32_t sequence_number,
+                                 const MatchingEngineClientResponse& response,
+                                 char* out) noexcept -> size_t {
+  auto report = reinterpret_cast<OrderEntryExecutionReport*>(out);
+  report->header = {sizeof(OrderEntryExecutionReport),
+                    ORDER_ENTRY_PROTOCOL_VERSION,
+                    OrderEntryMessageType::EXECUTION_REPORT};
+  report->sequence_number = sequence_number;
+  report->type = response.type;
+  report->ticker_id = narrowTickerId(response.ticker_id);
+  report->client_order_id = narrowOrderId(response.client_order_id);
+  report->market_order_id = response.market_order_id;
+  report->side = response.side;
+  report->price = response.price;
+  report->exec_quantity = response.exec_quantity;
+  report->leaves_quantity = response.leaves_quantity;
+  return sizeof(OrderEntryExecutionReport);
+}
+
+// Read a complete EXECUTION_REPORT frame for the session's client, returns
+// false if the frame is of another type or too short
+inline auto decodeClientResponse(const char* frame, ClientID client_id,
+                                 uint32_t& sequence_number,
+                                 MatchingEngineClientResponse& response) noexcept
+    -> bool {
+  const auto header = reinterpret_cast<const OrderEntryHeader*>(frame);
+  if (UNLIKELY(header->type != OrderEntryMessageType::EXECUTION_REPORT ||
+               header->length < sizeof(OrderEntryExecutionReport))) {
+    return false;
+  }
+  const auto report = reinterpret_cast<const OrderEntryExecutionReport*>(frame);
+  sequence_number = report->sequence_number;
+  response.type = report->type;
+  response.client_id = client_id;
+  response.ticker_id = widenTickerId(report->ticker_id);
+  response.client_order_id = widenOrderId(report->client_order_id);
+  response.market_order_id = report->market_order_id;
+  response.side = report->side;
+  response.price = report->price;
+  response.exec_quantity = report->exec_quantity;
+  response.leaves_quantity = report->leaves_quantity;
+  return true;
+}
+}  // namespace Exchange
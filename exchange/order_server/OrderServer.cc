@@ -3,22 +3,31 @@
 namespace Exchange { 
     OrderServer::OrderServer(ClientRequestLFQueue *client_request, 
     ClientResponseLFQueue *client_response, 
-    const std::string &iface_, int port_) :
+    const std::string &iface_, int port_, 
+    const RequestValidatorConfig &validator_config) :
 
     iface(iface_), port(port_), 
     outgoing_responses(client_response),
     logger("exchange_order_server.log"), 
-    tcp_server(logger), 
-    fifo_sequencer(client_request, &logger) {
+    tcp_server(logger, MATCHING_ENGINE_MAX_NUM_CLIENTS, ORDER_SERVER_SESSION_SEND_BUFFER_SIZE, ORDER_SERVER_SESSION_RECV_BUFFER_SIZE), 
+    fifo_sequencer(client_request, &logger), 
+    request_validator(validator_config) {
       cid_next_expected_sequence_number.fill(1); 
       cid_next_outgoing_sequence_number.fill(1); 
       cid_tcp_sockets.fill(nullptr); 
+      deferred_sockets.reserve(MATCHING_ENGINE_MAX_NUM_CLIENTS); 
+      retry_sockets.reserve(MATCHING_ENGINE_MAX_NUM_CLIENTS); 
+      logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, 
+        Common::getCurrentTimeStr(&time_str), validator_config.toString()); 
       tcp_server.recv_callback = [this](auto socket, auto rx_time) { 
         recvCallBack(socket, rx_time); 
       }; 
       tcp_server.recv_finished_callback = [this]() { 
         recvFinishedCallBack(); 
       }; 
+      tcp_server.disconnect_callback = [this](auto socket) { 
+        disconnectCallBack(socket); 
+      }; 
     }
     
     OrderServer::~OrderServer() { 
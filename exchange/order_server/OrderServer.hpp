@@ -8,12 +8,19 @@
 #include "ClientResponse.hpp"
 #include "ClientRequest.hpp"
 #include "FifoSequencer.hpp"
+#include "RequestValidator.hpp"
+#include "OrderEntryProtocol.hpp"
 
 namespace Exchange {
+ // Per session buffers, a few thousand requests or responses in flight per client between
+ // two loops of the order server
+ constexpr size_t ORDER_SERVER_SESSION_SEND_BUFFER_SIZE = 1024 * 1024;
+ constexpr size_t ORDER_SERVER_SESSION_RECV_BUFFER_SIZE = 256 * 1024;
  class OrderServer { 
   public:
   
-   OrderServer(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses, const std::string &iface, int port); 
+   OrderServer(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses, const std::string &iface, int port, 
+               const RequestValidatorConfig &validator_config); 
    ~OrderServer(); 
 
    auto start() -> void; 
@@ -24,12 +31,18 @@ namespace Exchange {
     while(is_running) { 
       tcp_server.poll(); 
       tcp_server.sendAndRecv(); 
+      if(UNLIKELY(!deferred_sockets.empty())) { 
+        retryDeferred(); 
+      } else if(UNLIKELY(fifo_sequencer.canPublish())) { 
+        // requests held back by a full matching engine queue go out as soon as it has room 
+        fifo_sequencer.sequenceAndPublish(); 
+      }
 
       for(auto client_response = outgoing_responses->getNextToRead(); 
           outgoing_responses->size() && client_response; 
           client_response = outgoing_responses->getNextToRead()) { 
         
-        auto &next_outgoing_sequence_number = cid_next_outgoing_sequence_number.at(client_response->client_id); 
+        const auto &next_outgoing_sequence_number = cid_next_outgoing_sequence_number.at(client_response->client_id); 
         logger.log(
           "%:% %() % Processing cid:% seq:% %\n",
            __FILE__, __LINE__, __FUNCTION__, 
@@ -38,59 +51,219 @@ namespace Exchange {
            next_outgoing_sequence_number, 
            client_response->toString()
         );
-        ASSERT(cid_tcp_sockets[client_response->client_id] != nullptr, 
-          "Do not have a TCPSocket for ClientID : " + std::to_string(client_response->client_id));
+        if(UNLIKELY(cid_tcp_sockets[client_response->client_id] == nullptr)) { 
+          logger.log("%:% %() % Dropping response, no TCPSocket for ClientID:%\n", 
+            __FILE__, __LINE__, __FUNCTION__, 
+            Common::getCurrentTimeStr(&time_str), client_response->client_id); 
+          outgoing_responses->updateReadIndex(); 
+          continue; 
+        }
         
-        cid_tcp_sockets[client_response->client_id]->send(&next_outgoing_sequence_number, sizeof(next_outgoing_sequence_number));
-        cid_tcp_sockets[client_response->client_id]->send(client_response, sizeof(MatchingEngineClientResponse)); 
+        sendResponse(cid_tcp_sockets[client_response->client_id], *client_response); 
         outgoing_responses->updateReadIndex(); 
-        ++next_outgoing_sequence_number;
       }
     }
    }
 
-   // Receive data from clients and put into the FIFO sequencer 
+   // Receive frames from clients, validate requests and put them into the FIFO sequencer. Frames 
+   // are decoded in batches straight into the sequencer's staging slots, the batch is validated in 
+   // one pass and then staged or answered request by request. 
    auto recvCallBack(TCPSocket *socket, Nanos rx_time) noexcept { 
     logger.log("%:% %() % Received socket:% len:% rx:%\n", 
         __FILE__, __LINE__, __FUNCTION__, 
         Common::getCurrentTimeStr(&time_str),
-        socket->socket_fd, socket->next_recv_valid_index, rx_time);
-    if(socket->next_recv_valid_index >= sizeof(OrderManagementClientRequest)) { 
-     size_t index = 0;
-     for(; index + sizeof(OrderManagementClientRequest) <= socket->next_recv_valid_index; index += sizeof(OrderManagementClientRequest)) { 
-       auto request = reinterpret_cast<const OrderManagementClientRequest*>(socket->recv_buffer.data() + index); 
-       logger.log("%:% %() % Received %\n", 
-        __FILE__, __LINE__, __FUNCTION__, 
-        Common::getCurrentTimeStr(&time_str), request->toString()
-       );
-       if(UNLIKELY(cid_tcp_sockets[request->me_client_request.client_id] == nullptr)) { 
-        cid_tcp_sockets[request->me_client_request.client_id] = socket; 
-       }
-       if(cid_tcp_sockets[request->me_client_request.client_id] != socket) { 
-        logger.log("%:% %() % Received ClientRequest from ClientId:% on different socket:% expected:%\n", __FILE__, __LINE__, __FUNCTION__,
-                    Common::getCurrentTimeStr(&time_str), 
-                    request->me_client_request.client_id, 
-                    socket->socket_fd,
-                    cid_tcp_sockets[request->me_client_request.client_id]->socket_fd);
-        continue;
-       }
-       auto &next_expected_sequence_number = cid_next_expected_sequence_number[request->me_client_request.client_id];
-       if(request->sequence_number != next_expected_sequence_number) { 
-         logger.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
-                    Common::getCurrentTimeStr(&time_str), 
-                    request->me_client_request.client_id, 
-                    next_expected_sequence_number, 
-                    request->sequence_number
-         );
-         continue;
-       }
-       ++next_expected_sequence_number; 
-       fifo_sequencer.addClientRequest(rx_time, request->me_client_request);  
+        socket->socket_fd, socket->next_recv_valid_index - socket->next_recv_read_index, rx_time);
+    auto read_index = socket->next_recv_read_index; 
+    bool is_corrupt = false, is_full = false; 
+    for(;;) { 
+     const auto batch_size = decodeBatch(socket, read_index, is_corrupt, is_full); 
+     request_validator.validate(batch_requests.data(), batch_size, reject_masks.data()); 
+     for(size_t i = 0; i < batch_size; i++) { 
+      stageRequest(socket, rx_time, i); 
+     }
+     // a batch that ran out of slots is staged now, which may have made room for the rest 
+     if(LIKELY(!is_full) || !batch_size) { 
+      break; 
+     }
+     is_full = false; 
+    }
+    if(UNLIKELY(is_full)) { 
+     // back-pressure: leave the remaining frames in the socket buffer until the matching engine catches up
+     logger.log("%:% %() % Sequencer full, deferring % bytes on socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), socket->next_recv_valid_index - read_index, socket->socket_fd);
+     if(std::find_if(deferred_sockets.begin(), deferred_sockets.end(), 
+                     [socket](const auto &deferred) { return deferred.first == socket; }) == deferred_sockets.end()) { 
+       deferred_sockets.emplace_back(socket, rx_time); 
+     }
+    }
+    if(UNLIKELY(is_corrupt)) { 
+     // framing is lost, nothing more can be read from this session 
+     logger.log("%:% %() % Disconnecting socket:% after a corrupt frame header, dropping % bytes\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), socket->socket_fd, socket->next_recv_valid_index - read_index);
+     read_index = socket->next_recv_valid_index; 
+     tcp_server.markDead(socket); 
+    }
+    socket->next_recv_read_index = read_index; 
+  }
+
+  // Decode the complete frames from read_index on into reserved sequencer slots and advance 
+  // read_index past them, returns the number of requests decoded. Stops early and sets is_full 
+  // when the sequencer runs out of slots. 
+  auto decodeBatch(TCPSocket *socket, size_t &read_index, bool &is_corrupt, bool &is_full) noexcept -> size_t { 
+   size_t batch_size = 0; 
+   for(size_t frame_size; (frame_size = orderEntryFrameSize(socket->recv_buffer.data() + read_index, 
+                                                            socket->next_recv_valid_index - read_index, is_corrupt)); 
+       read_index += frame_size) { 
+    const auto frame = socket->recv_buffer.data() + read_index; 
+    const auto header = reinterpret_cast<const OrderEntryHeader *>(frame); 
+    if(UNLIKELY(header->type == OrderEntryMessageType::LOGON)) { 
+     if(frame_size >= sizeof(OrderEntryLogon)) { 
+      logon(socket, reinterpret_cast<const OrderEntryLogon *>(frame)->client_id); 
      }
-     // clip the processed part
-     memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + index, socket->next_recv_valid_index - index); 
-     socket->next_recv_valid_index -= index; 
+     continue; 
     }
+    const auto index = fifo_sequencer.reserve(); 
+    if(UNLIKELY(index == FIFOSequencer::INVALID_INDEX)) { 
+     is_full = true; 
+     break; 
+    }
+    auto &request = fifo_sequencer.stagedRequest(index); 
+    if(UNLIKELY(!decodeClientRequest(frame, socket->client_id, batch_sequence_numbers[batch_size], request))) { 
+     logger.log("%:% %() % Dropping unexpected % on socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                 Common::getCurrentTimeStr(&time_str), header->toString(), socket->socket_fd);
+     fifo_sequencer.release(index); 
+     continue; 
+    }
+    batch_indices[batch_size] = index; 
+    batch_requests[batch_size] = &request; 
+    ++batch_size; 
+   }
+   return batch_size; 
+  }
+
+  // Check the sequence number of the i-th request of the batch, then stage it in the FIFO sequencer 
+  // or answer it with a reject 
+  auto stageRequest(TCPSocket *socket, Nanos rx_time, size_t i) noexcept -> void { 
+   const auto index = batch_indices[i]; 
+   const auto &request = *batch_requests[i]; 
+   const auto sequence_number = batch_sequence_numbers[i]; 
+   logger.log("%:% %() % Received seq:% %\n", 
+    __FILE__, __LINE__, __FUNCTION__, 
+    Common::getCurrentTimeStr(&time_str), sequence_number, request.toString()
+   );
+   if(UNLIKELY(request.client_id == CLIENT_ID_INVALID)) { 
+    logger.log("%:% %() % Dropping request before logon on socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), socket->socket_fd);
+    fifo_sequencer.release(index); 
+    return; 
+   }
+   auto &next_expected_sequence_number = cid_next_expected_sequence_number[request.client_id];
+   if(sequence_number != static_cast<uint32_t>(next_expected_sequence_number)) { 
+     logger.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), 
+                request.client_id, 
+                next_expected_sequence_number, 
+                sequence_number
+     );
+     fifo_sequencer.release(index); 
+     return;
+   }
+   ++next_expected_sequence_number; 
+   if(UNLIKELY(reject_masks[i])) { 
+     sendReject(socket, request, reject_masks[i]); 
+     fifo_sequencer.release(index); 
+     return; 
+   }
+   fifo_sequencer.addClientRequest(rx_time, index); 
+  }
+
+  // Bind a session to the client id it logged on with 
+  auto logon(TCPSocket *socket, ClientID client_id) noexcept -> void { 
+   if(UNLIKELY(socket->client_id != CLIENT_ID_INVALID)) { 
+     logger.log("%:% %() % Ignoring logon as ClientId:% on socket:% already logged on as ClientId:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), client_id, socket->socket_fd, socket->client_id);
+     return; 
+   }
+   if(UNLIKELY(client_id >= cid_tcp_sockets.size() || cid_tcp_sockets[client_id] != nullptr)) { 
+     logger.log("%:% %() % Rejecting logon as ClientId:% on socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), client_id, socket->socket_fd);
+     return; 
+   }
+   logger.log("%:% %() % ClientId:% logged on with socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+              Common::getCurrentTimeStr(&time_str), client_id, socket->socket_fd);
+   cid_tcp_sockets[client_id] = socket; 
+   socket->client_id = client_id; 
+  }
+
+  // Encode a response on the client's socket under its next outgoing sequence number. A client 
+  // that lets its session's send buffer fill up is disconnected rather than sent a stream with 
+  // a gap, it logs on again with fresh sequence numbers. 
+  auto sendResponse(TCPSocket *socket, const MatchingEngineClientResponse &client_response) noexcept -> void { 
+   if(UNLIKELY(socket->is_dead)) { 
+     logger.log("%:% %() % Dropping % for disconnecting socket:%\n", __FILE__, __LINE__, __FUNCTION__, 
+                Common::getCurrentTimeStr(&time_str), client_response.toString(), socket->socket_fd); 
+     return; 
+   }
+   auto &next_outgoing_sequence_number = cid_next_outgoing_sequence_number.at(client_response.client_id); 
+   char frame[sizeof(OrderEntryExecutionReport)]; 
+   const auto frame_size = encodeClientResponse(static_cast<uint32_t>(next_outgoing_sequence_number), client_response, frame); 
+   if(UNLIKELY(!socket->send(frame, frame_size))) { 
+     logger.log("%:% %() % Send buffer full, disconnecting ClientId:% on socket:%\n", __FILE__, __LINE__, __FUNCTION__, 
+                Common::getCurrentTimeStr(&time_str), client_response.client_id, socket->socket_fd); 
+     tcp_server.markDead(socket); 
+     return; 
+   }
+   ++next_outgoing_sequence_number; 
+  }
+
+  // Respond to a request that failed validation directly on the client's socket
+  auto sendReject(TCPSocket *socket, const MatchingEngineClientRequest &request, RequestRejectMask reject_mask) noexcept -> void { 
+   const MatchingEngineClientResponse client_response { 
+     request.type == ClientRequestType::CANCEL ? ClientResponseType::CANCEL_REJECTED : ClientResponseType::REJECTED, 
+     request.client_id, 
+     request.ticker_id, 
+     request.order_id, 
+     ORDER_ID_INVALID, 
+     request.side, 
+     request.price, 
+     QUANTITY_INVALID, 
+     QUANTITY_INVALID
+   }; 
+   logger.log("%:% %() % Rejecting % reason:% seq:% %\n", 
+     __FILE__, __LINE__, __FUNCTION__, 
+     Common::getCurrentTimeStr(&time_str), 
+     request.toString(), 
+     requestRejectMaskToString(reject_mask), 
+     cid_next_outgoing_sequence_number.at(request.client_id), 
+     client_response.toString()
+   );
+   sendResponse(socket, client_response); 
+  }
+  
+  // Re-feed requests left in socket buffers by back-pressure once the matching engine has drained 
+  auto retryDeferred() noexcept -> void { 
+   fifo_sequencer.sequenceAndPublish(); 
+   retry_sockets.swap(deferred_sockets); 
+   for(const auto &[socket, rx_time] : retry_sockets) { 
+     recvCallBack(socket, rx_time); 
+   }
+   retry_sockets.clear(); 
+   fifo_sequencer.sequenceAndPublish(); 
+  }
+
+  // Forget a closed connection so its client can log in again on a new socket with fresh sequence numbers 
+  auto disconnectCallBack(TCPSocket *socket) noexcept -> void { 
+   const auto client_id = socket->client_id; 
+   if(client_id != CLIENT_ID_INVALID) { 
+     logger.log("%:% %() % ClientId:% disconnected from socket:%\n", 
+       __FILE__, __LINE__, __FUNCTION__, 
+       Common::getCurrentTimeStr(&time_str), client_id, socket->socket_fd); 
+     cid_tcp_sockets[client_id] = nullptr; 
+     cid_next_expected_sequence_number[client_id] = 1; 
+     cid_next_outgoing_sequence_number[client_id] = 1; 
+   }
+   deferred_sockets.erase(std::remove_if(deferred_sockets.begin(), deferred_sockets.end(), 
+     [socket](const auto &deferred) { return deferred.first == socket; }), deferred_sockets.end()); 
   }
   
   auto recvFinishedCallBack() noexcept { 
@@ -120,5 +293,18 @@ namespace Exchange {
 
    Common::TCPServer tcp_server; 
    FIFOSequencer fifo_sequencer; 
+
+   // Pre-trade checks applied before requests are handed to the FIFO sequencer 
+   RequestValidator request_validator; 
+
+   // Batch of requests being decoded from one socket: their sequencer slots, the decoded 
+   // requests, their sequence numbers and validation results 
+   std::array<uint32_t, MATCHING_ENGINE_MAX_PENDING_REQUESTS> batch_indices; 
+   std::array<const MatchingEngineClientRequest*, MATCHING_ENGINE_MAX_PENDING_REQUESTS> batch_requests; 
+   std::array<uint32_t, MATCHING_ENGINE_MAX_PENDING_REQUESTS> batch_sequence_numbers; 
+   std::array<RequestRejectMask, MATCHING_ENGINE_MAX_PENDING_REQUESTS> reject_masks; 
+
+   // Sockets holding requests the FIFO sequencer had no room for, with the rx time they arrived at 
+   std::vector<std::pair<TCPSocket*, Nanos>> deferred_sockets, retry_sockets; 
  };
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+#include <sstream>
+
+#include "ClientRequest.hpp"
+#include "common/Types.hpp"
+
+using namespace Common;
+
+namespace Exchange {
+// Reasons a client request fails pre-trade validation, combined as bit flags
+enum class RequestRejectReason : uint8_t {
+  NONE = 0,
+  INVALID_TYPE = 1 << 0,
+  INVALID_CLIENT = 1 << 1,
+  INVALID_TICKER = 1 << 2,
+  INVALID_ORDER_ID = 1 << 3,
+  INVALID_SIDE = 1 << 4,
+  INVALID_PRICE = 1 << 5,
+  INVALID_QUANTITY = 1 << 6
+};
+
+typedef uint8_t RequestRejectMask;
+
+inline auto requestRejectReasonToString(RequestRejectReason reason)
+    -> std::string {
+  switch (reason) {
+  case RequestRejectReason::NONE:
+    return "NONE";
+  case RequestRejectReason::INVALID_TYPE:
+    return "INVALID_TYPE";
+  case RequestRejectReason::INVALID_CLIENT:
+    return "INVALID_CLIENT";
+  case RequestRejectReason::INVALID_TICKER:
+    return "INVALID_TICKER";
+  case RequestRejectReason::INVALID_ORDER_ID:
+    return "INVALID_ORDER_ID";
+  case RequestRejectReason::INVALID_SIDE:
+    return "INVALID_SIDE";
+  case RequestRejectReason::INVALID_PRICE:
+    return "INVALID_PRICE";
+  case RequestRejectReason::INVALID_QUANTITY:
+    return "INVALID_QUANTITY";
+  }
+  return "UNKNOWN";
+}
+
+inline auto requestRejectMaskToString(RequestRejectMask mask) -> std::string {
+  if (!mask) { return "NONE"; }
+  std::stringstream ss;
+  for (RequestRejectMask bit = 1; bit; bit = static_cast<RequestRejectMask>(bit << 1)) {
+    if (mask & bit) {
+      ss << requestRejectReasonToString(static_cast<RequestRejectReason>(bit))
+         << "|";
+    }
+  }
+  auto str = ss.str();
+  str.pop_back();
+  return str;
+}
+
+struct RequestValidatorConfig {
+  // Inclusive band of prices accepted on NEW orders
+  Price min_price = 1;
+  Price max_price = 0;
+  // Largest quantity accepted on a single NEW order
+  Quantity max_quantity = 0;
+
+  auto toString() const {
+    std::stringstream ss;
+    ss << "RequestValidatorCfg{"
+       << "price:[" << priceToString(min_price) << ","
+       << priceToString(max_price) << "] "
+       << "max-qty:" << quantityToString(max_quantity) << "}";
+    return ss.str();
+  }
+};
+
+// Stateless pre-trade checks run on the order server thread so malformed
+// requests never reach the matching engine. Every check is evaluated without
+// short-circuiting so a batch of requests validates as one straight-line loop.
+class RequestValidator final {
+public:
+  explicit RequestValidator(const RequestValidatorConfig& config_)
+      : config(config_) {}
+
+  auto validate(const MatchingEngineClientRequest& request) const noexcept
+      -> RequestRejectMask {
+    const bool is_new = (request.type == ClientRequestType::NEW);
+    const bool is_cancel = (request.type == ClientRequestType::CANCEL);
+    const bool bad_side =
+        (request.side != Side::BUY) & (request.side != Side::SELL);
+    const bool bad_price =
+        (request.price < config.min_price) | (request.price > config.max_price);
+    const bool bad_quantity = (request.quantity == 0) |
+                              (request.quantity > config.max_quantity);
+    return static_cast<RequestRejectMask>(
+        (!(is_new | is_cancel) * flag(RequestRejectReason::INVALID_TYPE)) |
+        ((request.client_id >= MATCHING_ENGINE_MAX_NUM_CLIENTS) *
+         flag(RequestRejectReason::INVALID_CLIENT)) |
+        ((request.ticker_id >= MATCHING_ENGINE_MAX_TICKERS) *
+         flag(RequestRejectReason::INVALID_TICKER)) |
+        ((request.order_id >= MATCHING_ENGINE_MAX_ORDER_IDS) *
+         flag(RequestRejectReason::INVALID_ORDER_ID)) |
+        ((is_new & bad_side) * flag(RequestRejectReason::INVALID_SIDE)) |
+        ((is_new & bad_price) * flag(RequestRejectReason::INVALID_PRICE)) |
+        ((is_new & bad_quantity) * flag(RequestRejectReason::INVALID_QUANTITY)));
+  }
+
+  // Validate a batch of requests decoded off the wire
+  auto validate(const MatchingEngineClientRequest* const* requests, size_t count,
+                RequestRejectMask* reject_masks) const noexcept -> void {
+    for (size_t i = 0; i < count; i++) {
+      reject_masks[i] = validate(*requests[i]);
+    }
+  }
+
+  auto getConfig() const noexcept -> const RequestValidatorConfig& {
+    return config;
+  }
+
+  RequestValidator() = delete;
+  RequestValidator(const RequestValidator&) = delete;
+  RequestValidator(const RequestValidator&&) = delete;
+  RequestValidator& operator=(const RequestValidator&) = delete;
+  RequestValidator& operator=(const RequestValidator&&) = delete;
+
+private:
+  static constexpr auto flag(RequestRejectReason reason) noexcept -> int {
+    return static_cast<int>(reason);
+  }
+
+  const RequestValidatorConfig config;
+};
+}  // namespace Exchange
@@ -1,30 +1,71 @@
 #include "MarketDataConsumer.hpp"
 
+#include <algorithm>
+
 namespace Trading { 
  MarketDataConsumer::MarketDataConsumer(
     Common::ClientID client_id, Exchange::MarketUpdateLFQueue *market_update_queue, const std::string &iface_, 
-    const std::string &snapshot_ip_, int snapshot_port_, 
-    const std::string &incremental_ip_, int incremental_port_
+    const Exchange::MarketDataChannelConfigs &channels_, const std::vector<TickerID> &tickers, 
+    const std::string &replay_ip_
  ) : incoming_md_queue(market_update_queue), 
       is_running(false), 
       logger("trading_market_data_consumer_" + std::to_string(client_id) + ".log"), 
-      incremental_mcast_socket(logger), 
-      snapshot_mcast_socket(logger), 
       iface(iface_), 
-      snapshot_ip(snapshot_ip_), 
-      snapshot_port(snapshot_port_), 
-      incremental_ip(incremental_ip_), 
-      incremental_port(incremental_port_) { 
+      replay_ip(replay_ip_) { 
+
+      next_expected_ticker_sequence_number.fill(1); 
+      for(size_t ticker_id = 0; ticker_id < MATCHING_ENGINE_MAX_TICKERS; ++ticker_id) { 
+        ticker_queued_msgs.emplace_back(std::make_unique<QueuedMarketUpdates>(MARKET_DATA_TICKER_QUEUE_SIZE)); 
+      }
+
+      // join a channel only if it carries one of our tickers 
+      const auto channel_of_ticker = Exchange::channelsByTicker(channels_); 
+      std::vector<MarketDataChannel*> joined_channels(channels_.size(), nullptr); 
+      for(const auto ticker_id : tickers) { 
+        const auto channel_id = channel_of_ticker.at(ticker_id); 
+        if(channel_id == channels_.size()) { 
+          logger.log("%:% %() % No market data channel carries ticker:%\n", 
+            __FILE__, __LINE__, __FUNCTION__, 
+            Common::getCurrentTimeStr(&time_str), tickerIdToString(ticker_id)); 
+          continue; 
+        }
+        if(!joined_channels[channel_id]) { 
+          joined_channels[channel_id] = channels.emplace_back(std::make_unique<MarketDataChannel>(channels_[channel_id], logger)).get(); 
+        }
+      }
+      for(size_t channel_id = 0; channel_id < channels_.size(); ++channel_id) { 
+        auto channel = joined_channels[channel_id]; 
+        if(!channel) { 
+          continue; 
+        }
+        // every ticker of a joined channel arrives on it and is passed on 
+        for(const auto ticker_id : channel->config.tickers) { 
+          ticker_channel[ticker_id] = channel; 
+        }
+        logger.log("%:% %() % Joining %\n", 
+          __FILE__, __LINE__, __FUNCTION__, 
+          Common::getCurrentTimeStr(&time_str), channel->config.toString()); 
+
+        auto recv_callback = [this, channel](auto socket) { 
+          recvCallback(*channel, socket); 
+        }; 
+        channel->incremental_mcast_socket.recv_callback = recv_callback;
+        ASSERT(channel->incremental_mcast_socket.init(channel->config.incremental_ip, iface, channel->config.incremental_port, true) >= 0, 
+          "Unable to create incremental market data multicast socket"); 
+        ASSERT(channel->incremental_mcast_socket.join(channel->config.incremental_ip),  
+         "Join failed on:" + std::to_string(channel->incremental_mcast_socket.socket_fd) + " error:" + std::string(std::strerror(errno))); 
+        channel->snapshot_mcast_socket.recv_callback = recv_callback;  
 
-      auto recv_callback = [this](auto socket) { 
-        recvCallback(socket); 
-      }; 
-      incremental_mcast_socket.recv_callback = recv_callback;
-      ASSERT(incremental_mcast_socket.init(incremental_ip, iface, incremental_port, true) >= 0, 
-        "Unable to create incremental market data multicast socket"); 
-      ASSERT(incremental_mcast_socket.join(incremental_ip),  
-       "Join failed on:" + std::to_string(incremental_mcast_socket.socket_fd) + " error:" + std::string(std::strerror(errno))); 
-      snapshot_mcast_socket.recv_callback = recv_callback;  
+        // without a replay server every gap is recovered from the snapshot stream 
+        channel->replay_socket.recv_callback = [this, channel](auto socket, auto rx_time) { 
+          replayCallback(*channel, socket, rx_time); 
+        }; 
+        if(channel->replay_socket.connect(replay_ip, iface, channel->config.replay_port, false) < 0) { 
+          logger.log("%:% %() % Unable to connect to replay server ip:% port:% error:%\n", 
+            __FILE__, __LINE__, __FUNCTION__, 
+            Common::getCurrentTimeStr(&time_str), replay_ip, channel->config.replay_port, std::strerror(errno)); 
+        }
+      }
  }
 
  MarketDataConsumer::~MarketDataConsumer() { 
@@ -50,186 +91,290 @@ namespace Trading {
     Common::getCurrentTimeStr(&time_str)
   );
   while(is_running) { 
-    incremental_mcast_socket.sendAndRecv(); 
-    snapshot_mcast_socket.sendAndRecv(); 
+    for(auto &channel : channels) { 
+      channel->incremental_mcast_socket.sendAndRecv(); 
+      channel->snapshot_mcast_socket.sendAndRecv(); 
+      if(channel->replay_socket.socket_fd >= 0) { 
+        channel->replay_socket.sendAndRecv(); 
+      }
+      if(UNLIKELY(channel->is_replay_pending && Common::getCurrentNanos() - channel->replay_request_time > MARKET_DATA_REPLAY_TIMEOUT)) { 
+        logger.log("%:% %() % Timed out waiting for %\n", 
+          __FILE__, __LINE__, __FUNCTION__, 
+          Common::getCurrentTimeStr(&time_str), channel->replay_requests.front().toString()); 
+        finishReplay(*channel, true); 
+      }
+    }
   }
  }
  
- auto MarketDataConsumer::startSnapshotSync() noexcept -> void { 
-  snapshot_queued_msgs.clear(); 
-  incremental_queued_msgs.clear(); 
+ auto MarketDataConsumer::queueReplay(MarketDataChannel &channel, size_t first_sequence_number, size_t last_sequence_number) noexcept -> void { 
+  // a gap longer than one replay response is requested in pieces, as many as the queue has room for 
+  while(channel.replay_socket.socket_fd >= 0 && first_sequence_number <= last_sequence_number && 
+        channel.replay_requests.size() < MARKET_DATA_MAX_REPLAY_GAPS) { 
+    Exchange::MDPReplayRequest request; 
+    request.first_sequence_number = first_sequence_number; 
+    request.message_count = static_cast<uint16_t>(std::min<size_t>(last_sequence_number - first_sequence_number + 1, 
+                                                                   Exchange::MDP_REPLAY_MAX_MESSAGES)); 
+    channel.replay_requests.push_back(request); 
+    first_sequence_number += request.message_count; 
+  }
+  if(UNLIKELY(first_sequence_number <= last_sequence_number)) { 
+    // the tickers these updates touched stay in recovery and are rebuilt from a snapshot once the queue drains 
+    logger.log("%:% %() % Cannot replay seq:[%,%] with % gaps queued.\n", 
+      __FILE__, __LINE__, __FUNCTION__, 
+      Common::getCurrentTimeStr(&time_str), first_sequence_number, last_sequence_number, channel.replay_requests.size()); 
+  }
+  if(!channel.is_replay_pending && !channel.replay_requests.empty()) { 
+    requestReplay(channel); 
+  }
+ }
+
+ auto MarketDataConsumer::requestReplay(MarketDataChannel &channel) noexcept -> void { 
+  const auto &request = channel.replay_requests.front(); 
+  channel.replay_request_time = Common::getCurrentNanos(); 
+  channel.is_replay_pending = true; 
+  logger.log("%:% %() % Requesting %\n", 
+    __FILE__, __LINE__, __FUNCTION__, 
+    Common::getCurrentTimeStr(&time_str), request.toString()); 
+  if(UNLIKELY(!channel.replay_socket.send(&request, sizeof(request)))) { 
+    // the replay server is not reading, recover from snapshots as after a timeout 
+    logger.log("%:% %() % Replay socket full, dropping %\n", 
+      __FILE__, __LINE__, __FUNCTION__, 
+      Common::getCurrentTimeStr(&time_str), request.toString()); 
+    finishReplay(channel, true); 
+  }
+ }
+
+ auto MarketDataConsumer::finishReplay(MarketDataChannel &channel, bool drop_all) noexcept -> void { 
+  channel.is_replay_pending = false; 
+  if(drop_all) { 
+    channel.replay_requests.clear(); 
+  } else { 
+    channel.replay_requests.erase(channel.replay_requests.begin()); 
+  }
+  if(!channel.replay_requests.empty()) { 
+    requestReplay(channel); 
+    return; 
+  }
+  checkTickersNeedingSnapshot(channel); 
+ }
+
+ auto MarketDataConsumer::replayCallback(MarketDataChannel &channel, TCPSocket *socket, Nanos rx_time) noexcept -> void { 
+  auto read_index = socket->next_recv_read_index; 
+  while(read_index + sizeof(Exchange::MDPReplayResponse) <= socket->next_recv_valid_index) { 
+    const auto response = reinterpret_cast<const Exchange::MDPReplayResponse *>(socket->recv_buffer.data() + read_index); 
+    if(UNLIKELY(response->length < sizeof(Exchange::MDPReplayResponse) || 
+                response->length > sizeof(Exchange::MDPReplayResponse) + 
+                                   Exchange::MDP_REPLAY_MAX_MESSAGES * Exchange::MDP_MAX_ENCODED_UPDATE_SIZE)) { 
+      // framing is lost, nothing more can be read from this connection 
+      logger.log("%:% %() % Dropping % bytes after a corrupt % rx:%\n", 
+        __FILE__, __LINE__, __FUNCTION__, 
+        Common::getCurrentTimeStr(&time_str), socket->next_recv_valid_index - read_index, response->toString(), rx_time); 
+      read_index = socket->next_recv_valid_index; 
+      if(channel.is_replay_pending) { 
+        finishReplay(channel, true); 
+      }
+      break; 
+    }
+    if(read_index + response->length > socket->next_recv_valid_index) { 
+      break; 
+    }
+    logger.log("%:% %() % Received % rx:%\n", 
+      __FILE__, __LINE__, __FUNCTION__, 
+      Common::getCurrentTimeStr(&time_str), response->toString(), rx_time); 
+    const char *next = socket->recv_buffer.data() + read_index + sizeof(Exchange::MDPReplayResponse); 
+    const char *end  = socket->recv_buffer.data() + read_index + response->length; 
+    read_index += response->length; 
+    // responses to requests given up on are stale 
+    if(!channel.is_replay_pending || response->first_sequence_number != channel.replay_requests.front().first_sequence_number) { 
+      continue; 
+    }
+    if(response->status != Exchange::MDPReplayStatus::OK || response->message_count != channel.replay_requests.front().message_count) { 
+      finishReplay(channel, false); 
+      continue; 
+    }
+    // replayed updates go through the same ticker sequencing as live ones, updates already applied are skipped 
+    Exchange::MDPCodecState codec_state; 
+    Exchange::MatchingEngineMarketUpdate update; 
+    size_t ticker_sequence_number = 0; 
+    uint16_t num_updates = 0; 
+    for(; num_updates < response->message_count; num_updates++) { 
+      if(UNLIKELY(!Exchange::decodeMarketUpdate(next, end, codec_state, update, ticker_sequence_number))) { 
+        logger.log("%:% %() % Truncated %\n", 
+          __FILE__, __LINE__, __FUNCTION__, 
+          Common::getCurrentTimeStr(&time_str), response->toString()); 
+        break; 
+      }
+      applyTickerUpdate(channel, ticker_sequence_number, update); 
+    }
+    logger.log("%:% %() % Filled gap with % replayed updates in %ns.\n", 
+      __FILE__, __LINE__, __FUNCTION__, 
+      Common::getCurrentTimeStr(&time_str), num_updates, 
+      Common::getCurrentNanos() - channel.replay_request_time); 
+    finishReplay(channel, false); 
+  }
+  socket->next_recv_read_index = read_index; 
+ }
+
+ auto MarketDataConsumer::checkTickersNeedingSnapshot(MarketDataChannel &channel) noexcept -> void { 
+  if(!channel.replay_requests.empty()) { 
+    return; 
+  }
+  for(const auto ticker_id : channel.config.tickers) { 
+    if(ticker_in_recovery[ticker_id] && !ticker_needs_snapshot[ticker_id]) { 
+      logger.log("%:% %() % Cannot fill gap on ticker:% at ticker seq:%, recovering from snapshot.\n", 
+        __FILE__, __LINE__, __FUNCTION__, 
+        Common::getCurrentTimeStr(&time_str), tickerIdToString(ticker_id), next_expected_ticker_sequence_number[ticker_id]); 
+      ticker_needs_snapshot[ticker_id] = true; 
+      startSnapshotSync(channel); 
+    }
+  }
+ }
+
+ auto MarketDataConsumer::startSnapshotSync(MarketDataChannel &channel) noexcept -> void { 
+  if(channel.is_snapshot_subscribed) { 
+    return; 
+  }
+  resetSnapshotQueue(channel); 
+  channel.next_snapshot_packet_sequence_number = 0; 
   
-  ASSERT(snapshot_mcast_socket.init(snapshot_ip, iface, snapshot_port, true) >= 0, 
+  ASSERT(channel.snapshot_mcast_socket.init(channel.config.snapshot_ip, iface, channel.config.snapshot_port, true) >= 0, 
    "Unable to create snapshot mcast socker. error : " + std::string(std::strerror(errno))
   );
   
-  ASSERT(snapshot_mcast_socket.join(snapshot_ip), 
-   "Join failed on:" + std::to_string(snapshot_mcast_socket.socket_fd) + " error:" + std::string(std::strerror(errno))
+  ASSERT(channel.snapshot_mcast_socket.join(channel.config.snapshot_ip), 
+   "Join failed on:" + std::to_string(channel.snapshot_mcast_socket.socket_fd) + " error:" + std::string(std::strerror(errno))
   );
+  channel.is_snapshot_subscribed = true; 
+ }
+
+ auto MarketDataConsumer::resetSnapshotQueue(MarketDataChannel &channel) noexcept -> void { 
+  channel.snapshot_queued_msgs.reset(0); 
+  channel.snapshot_end_sequence_number = 0; 
+  channel.snapshot_clear_sequence_number.fill(0); 
  }
 
- auto MarketDataConsumer::checkSnapshotSync() noexcept -> void { 
-  if(snapshot_queued_msgs.empty()) { 
+ // Called after every queued message, the checks are O(1) until a complete snapshot is applied 
+ auto MarketDataConsumer::checkSnapshotSync(MarketDataChannel &channel) noexcept -> void { 
+  if(channel.snapshot_queued_msgs.empty()) { 
     return; 
   }
-  const auto &first_msg = snapshot_queued_msgs.begin()->second; 
   // First message type must be SNAPSHOT_START
-  if(first_msg.type != Exchange::MarketUpdateType::SNAPSHOT_START) { 
+  if(!channel.snapshot_queued_msgs.contains(0) || 
+     channel.snapshot_queued_msgs.at(0).me_market_update.type != Exchange::MarketUpdateType::SNAPSHOT_START) { 
    logger.log("%:% %() % Returning because have not seen a SNAPSHOT_START yet.\n",
     __FILE__, __LINE__, __FUNCTION__, 
     Common::getCurrentTimeStr(&time_str)
    );
-   snapshot_queued_msgs.clear(); 
+   resetSnapshotQueue(channel); 
    return; 
   }
-  std::vector<Exchange::MatchingEngineMarketUpdate> final_events;
-  auto have_complete_snapshot = true; 
-  int next_snapshot_sequence_number = 0; 
-  for(const auto &snapshot_ptr : snapshot_queued_msgs) { 
-    logger.log("%:% %() % % => %\n", 
-      __FILE__, __LINE__, __FUNCTION__,
-      Common::getCurrentTimeStr(&time_str), snapshot_ptr.first, snapshot_ptr.second.toString()
-    );  
-    if(snapshot_ptr.first != static_cast<size_t>(next_snapshot_sequence_number)) { 
-      have_complete_snapshot = false; 
-      logger.log("%:% %() % Detected gap in snapshot stream expected:% found:% %.\n",
-         __FILE__, __LINE__, __FUNCTION__,
-        Common::getCurrentTimeStr(&time_str), 
-        next_snapshot_sequence_number, 
-        snapshot_ptr.first, 
-        snapshot_ptr.second.toString()
-      );
-      break; 
-    }
-    if(snapshot_ptr.second.type != Exchange::MarketUpdateType::SNAPSHOT_START && 
-       snapshot_ptr.second.type != Exchange::MarketUpdateType::SNAPSHOT_END) { 
-      final_events.push_back(snapshot_ptr.second); 
-    }
-    ++next_snapshot_sequence_number; 
-  } 
-  if(!have_complete_snapshot) { 
+  if(channel.snapshot_queued_msgs.nextMissing() <= channel.snapshot_queued_msgs.lastSequenceNumber()) { 
     logger.log(
-      "%:% %() % Returning because found gaps in snapshot stream.\n",
+      "%:% %() % Returning because found gaps in snapshot stream expected:% found:%.\n",
       __FILE__, __LINE__, __FUNCTION__, 
-      Common::getCurrentTimeStr(&time_str)
+      Common::getCurrentTimeStr(&time_str), 
+      channel.snapshot_queued_msgs.nextMissing(), 
+      channel.snapshot_queued_msgs.lastSequenceNumber()
     );
-    snapshot_queued_msgs.clear(); 
+    resetSnapshotQueue(channel); 
+    return; 
+  }
+  if(!channel.snapshot_end_sequence_number) { 
     return; 
   }
 
-  const auto &last_snapshot_msg = snapshot_queued_msgs.rbegin()->second; 
-  if(last_snapshot_msg.type != Exchange::MarketUpdateType::SNAPSHOT_END) { 
-    logger.log(
-      "%:% %() % Returning because have not seen a SNAPSHOT_END yet.\n",
+  for(const auto ticker_id : channel.config.tickers) { 
+    if(ticker_needs_snapshot[ticker_id] && applyTickerSnapshot(channel, ticker_id)) { 
+      ticker_needs_snapshot[ticker_id] = false; 
+      resumeTicker(ticker_id); 
+    }
+  }
+  resetSnapshotQueue(channel); 
+  // tickers with gaps after the snapshot wait for the next one 
+  checkTickersNeedingSnapshot(channel); 
+  if(std::none_of(channel.config.tickers.begin(), channel.config.tickers.end(), 
+                  [this](auto ticker_id) { return ticker_needs_snapshot[ticker_id]; })) { 
+    channel.is_snapshot_subscribed = false; 
+    channel.snapshot_mcast_socket.leave(channel.config.snapshot_ip, channel.config.snapshot_port); 
+  }
+ }
+
+ auto MarketDataConsumer::applyTickerSnapshot(MarketDataChannel &channel, TickerID ticker_id) noexcept -> bool { 
+  const auto clear_sequence_number = channel.snapshot_clear_sequence_number[ticker_id]; 
+  if(!clear_sequence_number) { 
+    return false; 
+  }
+  // the CLEAR carries the ticker sequence number of the last update the snapshot reflects, the snapshot is 
+  // of no use if the book has already applied updates past it 
+  const auto last_ticker_sequence_number = channel.snapshot_queued_msgs.at(clear_sequence_number).ticker_sequence_number; 
+  if(last_ticker_sequence_number + 1 < next_expected_ticker_sequence_number[ticker_id]) { 
+    logger.log("%:% %() % Snapshot of ticker:% at ticker seq:% is older than the book, expected:%.\n", 
       __FILE__, __LINE__, __FUNCTION__, 
-      Common::getCurrentTimeStr(&time_str)
-    );
-    return; 
+      Common::getCurrentTimeStr(&time_str), tickerIdToString(ticker_id), 
+      last_ticker_sequence_number, next_expected_ticker_sequence_number[ticker_id]); 
+    return false; 
   }
+  size_t num_orders = 0; 
+  auto sequence_number = clear_sequence_number; 
+  do { 
+    auto next_write = incoming_md_queue->getNextToWrite(); 
+    *next_write = channel.snapshot_queued_msgs.at(sequence_number).me_market_update; 
+    incoming_md_queue->updateWriteIndex(); 
+    ++num_orders; 
+    ++sequence_number; 
+  } while(sequence_number < channel.snapshot_end_sequence_number && 
+          channel.snapshot_queued_msgs.at(sequence_number).me_market_update.type != Exchange::MarketUpdateType::CLEAR); 
+  next_expected_ticker_sequence_number[ticker_id] = last_ticker_sequence_number + 1; 
+  logger.log("%:% %() % Recovered ticker:% from % snapshot orders at ticker seq:%.\n", 
+    __FILE__, __LINE__, __FUNCTION__, 
+    Common::getCurrentTimeStr(&time_str), tickerIdToString(ticker_id), num_orders - 1, last_ticker_sequence_number); 
+  return true; 
+ }
 
-  auto have_complete_incrementals = true; 
-  size_t num_incrementals = 0; 
-  next_expected_sequence_number = last_snapshot_msg.order_id + 1; 
-  for(auto inc_itr = incremental_queued_msgs.begin(); inc_itr != incremental_queued_msgs.end(); inc_itr++) { 
+ auto MarketDataConsumer::queueMessage(MarketDataChannel &channel, const Exchange::MDPMarketUpdate *request) -> void { 
+  if(channel.snapshot_queued_msgs.contains(request->sequence_number)) { 
     logger.log(
-      "%:% %() % Checking next_exp:% vs. seq:% %.\n", 
+      "%:% %() % Packet drops on snapshot socket. Received for a 2nd time:%\n", 
       __FILE__, __LINE__, __FUNCTION__,
       Common::getCurrentTimeStr(&time_str), 
-      next_expected_sequence_number, 
-      inc_itr->first,
-      inc_itr->second.toString()
+      request->toString()
     );
-    if(inc_itr->first < next_expected_sequence_number) { 
-      continue;
-    }
-    if(inc_itr->first != next_expected_sequence_number) { 
-      logger.log(
-        "%:% %() % Detected gap in incremental stream expected:% found:% %.\n", 
-        __FILE__, __LINE__, __FUNCTION__,
-        Common::getCurrentTimeStr(&time_str), 
-        next_expected_sequence_number, 
-        inc_itr->first, 
-        inc_itr->second.toString()
-      ); 
-      have_complete_incrementals = false; 
-      break; 
-    }
+    resetSnapshotQueue(channel); 
+  }
+  if(UNLIKELY(!channel.snapshot_queued_msgs.insert(request->sequence_number, *request))) { 
     logger.log(
-      "%:% %() % % => %\n", 
+      "%:% %() % Snapshot larger than % messages, cannot queue:%\n", 
       __FILE__, __LINE__, __FUNCTION__,
       Common::getCurrentTimeStr(&time_str), 
-      inc_itr->first, 
-      inc_itr->second.toString()
-    ); 
-    if(inc_itr->second.type != Exchange::MarketUpdateType::SNAPSHOT_START && 
-       inc_itr->second.type != Exchange::MarketUpdateType::SNAPSHOT_END) { 
-      final_events.push_back(inc_itr->second);
-    }
-    ++next_expected_sequence_number; 
-    ++num_incrementals; 
-  }
-
-  if(!have_complete_incrementals) { 
-    logger.log(
-      "%:% %() % Returning because have gaps in queued incrementals.\n",
-      __FILE__, __LINE__, __FUNCTION__, 
-      Common::getCurrentTimeStr(&time_str)
+      channel.snapshot_queued_msgs.capacity(), 
+      request->toString()
     );
-    snapshot_queued_msgs.clear(); 
+    resetSnapshotQueue(channel); 
     return; 
   }
-
-  for(const auto &itr : final_events) { 
-    auto next_write = incoming_md_queue->getNextToWrite(); 
-    *next_write = itr; 
-    incoming_md_queue->updateWriteIndex(); 
-  }
-  logger.log(
-    "%:% %() % Recovered % snapshot and % incremental orders.\n", 
-    __FILE__, __LINE__, __FUNCTION__,
-    Common::getCurrentTimeStr(&time_str), 
-    snapshot_queued_msgs.size() - 2, 
-    num_incrementals
-  );
-
-  snapshot_queued_msgs.clear(); 
-  incremental_queued_msgs.clear(); 
-  in_recovery_mode = false; 
-  snapshot_mcast_socket.leave(snapshot_ip, snapshot_port); 
-  return; 
- }
-
- auto MarketDataConsumer::queueMessage(bool is_snapshot, const Exchange::MDPMarketUpdate *request) -> void { 
-  if(is_snapshot) { 
-    if(snapshot_queued_msgs.find(request->sequence_number) != snapshot_queued_msgs.end()) { 
-      logger.log(
-        "%:% %() % Packet drops on snapshot socket. Received for a 2nd time:%\n", 
-        __FILE__, __LINE__, __FUNCTION__,
-        Common::getCurrentTimeStr(&time_str), 
-        request->toString()
-      );
-      snapshot_queued_msgs.clear(); 
-    }
-    snapshot_queued_msgs[request->sequence_number] = request->me_market_update; 
-  } else { 
-    incremental_queued_msgs[request->sequence_number] = request->me_market_update; 
+  const auto &me_market_update = request->me_market_update; 
+  if(me_market_update.type == Exchange::MarketUpdateType::SNAPSHOT_END) { 
+    channel.snapshot_end_sequence_number = request->sequence_number; 
+  } else if(me_market_update.type == Exchange::MarketUpdateType::CLEAR && me_market_update.ticker_id < MATCHING_ENGINE_MAX_TICKERS && 
+            ticker_channel[me_market_update.ticker_id] == &channel) { 
+    channel.snapshot_clear_sequence_number[me_market_update.ticker_id] = request->sequence_number; 
   }
   logger.log(
-    "%:% %() % size snapshot:% incremental:% % => %\n", 
+    "%:% %() % size snapshot:% % => %\n", 
     __FILE__, __LINE__, __FUNCTION__,
     Common::getCurrentTimeStr(&time_str), 
-    snapshot_queued_msgs.size(), 
-    incremental_queued_msgs.size(), 
+    channel.snapshot_queued_msgs.size(), 
     request->sequence_number, 
     request->toString()
   ); 
-  checkSnapshotSync(); 
+  checkSnapshotSync(channel); 
  }
 
 
- auto MarketDataConsumer::recvCallback(McastSocket *socket) noexcept -> void { 
-  const auto is_snapshot = (socket->socket_fd == snapshot_mcast_socket.socket_fd); 
-  if(UNLIKELY(is_snapshot && !in_recovery_mode)) { 
+ auto MarketDataConsumer::recvCallback(MarketDataChannel &channel, McastSocket *socket) noexcept -> void { 
+  const auto is_snapshot = (socket->socket_fd == channel.snapshot_mcast_socket.socket_fd); 
+  if(UNLIKELY(is_snapshot && !channel.is_snapshot_subscribed)) { 
     socket->next_recv_valid_index = 0; 
     logger.log(
       "%:% %() % WARN Not expecting snapshot messages.\n",
@@ -238,51 +383,152 @@ namespace Trading {
     );
     return; 
   }
-  if(socket->next_recv_valid_index >= sizeof(Exchange::MDPMarketUpdate)) { 
-    size_t index = 0; 
-    for(; index + sizeof(Exchange::MDPMarketUpdate) <= socket->next_recv_valid_index; index += sizeof(Exchange::MDPMarketUpdate)) { 
-      auto request = reinterpret_cast<const Exchange::MDPMarketUpdate *>(socket->recv_buffer.data() + index); 
-      logger.log(
-        "%:% %() % Received % socket len:% %\n",
-        __FILE__, __LINE__, __FUNCTION__,
-        Common::getCurrentTimeStr(&time_str),
-        (is_snapshot ? "snapshot" : "incremental"), 
-        sizeof(Exchange::MDPMarketUpdate), 
-        request->toString()
-      ); 
-      const bool already_in_recovery = in_recovery_mode; 
-      in_recovery_mode = (already_in_recovery || request->sequence_number != next_expected_sequence_number); 
-      if(UNLIKELY(in_recovery_mode)) { 
-        // Just entered the recovery mode 
-        if(UNLIKELY(!already_in_recovery)) { 
-          logger.log(
-            "%:% %() % Packet drops on % socket. SeqNum expected:% received:%\n", 
-            __FILE__, __LINE__, __FUNCTION__,
-            Common::getCurrentTimeStr(&time_str), 
-            (is_snapshot ? "snapshot" : "incremental"), 
-            next_expected_sequence_number, 
-            request->sequence_number
-          );
-          startSnapshotSync(); 
-        }
-        // queue up the market data update message and see if recovery/synchronization can be completed successfully
-        queueMessage(is_snapshot, request); 
-      } else if(!is_snapshot) { // not in recovery mode and received a packet in correct order 
-        logger.log(
-          "%:% %() % %\n",
-           __FILE__, __LINE__, __FUNCTION__,
-          Common::getCurrentTimeStr(&time_str), 
-          request->toString()
-        );
-        ++next_expected_sequence_number; 
-        auto next_write = incoming_md_queue->getNextToWrite(); 
-        *next_write = request->me_market_update; 
-        incoming_md_queue->updateWriteIndex(); 
+  // Packets arrive whole, each one is a header followed by message_count encoded updates 
+  size_t index = 0; 
+  while(index + sizeof(Exchange::MDPPacketHeader) <= socket->next_recv_valid_index) { 
+    // recovery may complete part way through the snapshot data, the rest of it is stale 
+    if(UNLIKELY(is_snapshot && !channel.is_snapshot_subscribed)) { 
+      index = socket->next_recv_valid_index; 
+      break; 
+    }
+    const auto header = reinterpret_cast<const Exchange::MDPPacketHeader *>(socket->recv_buffer.data() + index); 
+    if(UNLIKELY(header->packet_size < sizeof(Exchange::MDPPacketHeader) || index + header->packet_size > socket->next_recv_valid_index)) { 
+      logger.log("%:% %() % Dropping malformed packet on % socket %\n", 
+        __FILE__, __LINE__, __FUNCTION__, 
+        Common::getCurrentTimeStr(&time_str), 
+        (is_snapshot ? "snapshot" : "incremental"), header->toString()); 
+      index = socket->next_recv_valid_index; 
+      break; 
+    }
+    checkPacketSequence(channel, is_snapshot, header); 
+    const char *next = socket->recv_buffer.data() + index + sizeof(Exchange::MDPPacketHeader); 
+    const char *end  = socket->recv_buffer.data() + index + header->packet_size; 
+    Exchange::MDPCodecState codec_state; 
+    Exchange::MDPMarketUpdate request; 
+    for(uint16_t i = 0; i < header->message_count && (!is_snapshot || channel.is_snapshot_subscribed); i++) { 
+      if(UNLIKELY(!Exchange::decodeMarketUpdate(next, end, codec_state, request.me_market_update, request.ticker_sequence_number))) { 
+        logger.log("%:% %() % Truncated update % of % in % socket %\n", 
+          __FILE__, __LINE__, __FUNCTION__, 
+          Common::getCurrentTimeStr(&time_str), i, 
+          (is_snapshot ? "snapshot" : "incremental"), header->toString()); 
+        break; 
       }
+      request.sequence_number = header->base_sequence_number + i; 
+      processMarketUpdate(channel, is_snapshot, &request); 
     }
-    memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + index, socket->next_recv_valid_index - index); 
-    socket->next_recv_valid_index -= index; 
+    index += header->packet_size; 
   }
+  memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + index, socket->next_recv_valid_index - index); 
+  socket->next_recv_valid_index -= index; 
   return; 
  }
-}; 
\ No newline at end of file
+ 
+ // Detect lost packets from the packet sequence number, the first packet seen on a stream sets the expectation 
+ auto MarketDataConsumer::checkPacketSequence(MarketDataChannel &channel, bool is_snapshot, const Exchange::MDPPacketHeader *header) noexcept -> void { 
+  auto &next_packet_sequence_number = (is_snapshot ? channel.next_snapshot_packet_sequence_number : channel.next_incremental_packet_sequence_number); 
+  if(UNLIKELY(next_packet_sequence_number && header->packet_sequence_number != next_packet_sequence_number)) { 
+    logger.log(
+      "%:% %() % Lost % packets on % socket. PktSeq expected:% received:%\n", 
+      __FILE__, __LINE__, __FUNCTION__,
+      Common::getCurrentTimeStr(&time_str), 
+      static_cast<int64_t>(header->packet_sequence_number - next_packet_sequence_number), 
+      (is_snapshot ? "snapshot" : "incremental"), 
+      next_packet_sequence_number, 
+      header->packet_sequence_number
+    );
+  }
+  next_packet_sequence_number = header->packet_sequence_number + 1; 
+ }
+
+ auto MarketDataConsumer::processMarketUpdate(MarketDataChannel &channel, bool is_snapshot, const Exchange::MDPMarketUpdate *request) noexcept -> void { 
+  logger.log(
+    "%:% %() % Received % socket len:% %\n",
+    __FILE__, __LINE__, __FUNCTION__,
+    Common::getCurrentTimeStr(&time_str),
+    (is_snapshot ? "snapshot" : "incremental"), 
+    sizeof(Exchange::MDPMarketUpdate), 
+    request->toString()
+  ); 
+  if(is_snapshot) { 
+    queueMessage(channel, request); 
+    return; 
+  }
+  if(UNLIKELY(request->sequence_number > channel.next_expected_sequence_number)) { 
+    logger.log(
+      "%:% %() % Packet drops on incremental socket. SeqNum expected:% received:%\n", 
+      __FILE__, __LINE__, __FUNCTION__,
+      Common::getCurrentTimeStr(&time_str), 
+      channel.next_expected_sequence_number, 
+      request->sequence_number
+    );
+    // queued before the update is applied so a ticker it puts in recovery waits for the replay 
+    queueReplay(channel, channel.next_expected_sequence_number, request->sequence_number - 1); 
+  }
+  channel.next_expected_sequence_number = std::max(channel.next_expected_sequence_number, request->sequence_number + 1); 
+  applyTickerUpdate(channel, request->ticker_sequence_number, request->me_market_update); 
+ }
+
+ auto MarketDataConsumer::applyTickerUpdate(MarketDataChannel &channel, size_t ticker_sequence_number, const Exchange::MatchingEngineMarketUpdate &update) noexcept -> void { 
+  const auto ticker_id = update.ticker_id; 
+  if(UNLIKELY(ticker_id >= MATCHING_ENGINE_MAX_TICKERS || ticker_channel[ticker_id] != &channel)) { 
+    return; 
+  }
+  auto &next_expected = next_expected_ticker_sequence_number[ticker_id]; 
+  if(ticker_sequence_number < next_expected) { 
+    return; 
+  }
+  if(LIKELY(!ticker_in_recovery[ticker_id] && ticker_sequence_number == next_expected)) { 
+    ++next_expected; 
+    auto next_write = incoming_md_queue->getNextToWrite(); 
+    *next_write = update; 
+    incoming_md_queue->updateWriteIndex(); 
+    return; 
+  }
+  auto &queued_msgs = *ticker_queued_msgs[ticker_id]; 
+  if(!ticker_in_recovery[ticker_id]) { 
+    logger.log(
+      "%:% %() % Gap on ticker:% TickerSeqNum expected:% received:%\n", 
+      __FILE__, __LINE__, __FUNCTION__,
+      Common::getCurrentTimeStr(&time_str), 
+      tickerIdToString(ticker_id), 
+      next_expected, 
+      ticker_sequence_number
+    );
+    ticker_in_recovery[ticker_id] = true; 
+    queued_msgs.reset(next_expected); 
+  }
+  // keep the most recent incrementals, older ones are only useful with an older snapshot 
+  if(UNLIKELY(ticker_sequence_number - queued_msgs.firstSequenceNumber() >= queued_msgs.capacity())) { 
+    queued_msgs.advanceTo(ticker_sequence_number - queued_msgs.capacity() + 1); 
+  }
+  queued_msgs.insert(ticker_sequence_number, update); 
+  resumeTicker(ticker_id); 
+  if(ticker_in_recovery[ticker_id] && !ticker_needs_snapshot[ticker_id]) { 
+    checkTickersNeedingSnapshot(channel); 
+  }
+ }
+
+ auto MarketDataConsumer::resumeTicker(TickerID ticker_id) noexcept -> void { 
+  auto &queued_msgs = *ticker_queued_msgs[ticker_id]; 
+  auto &next_expected = next_expected_ticker_sequence_number[ticker_id]; 
+  queued_msgs.advanceTo(next_expected); 
+  size_t num_incrementals = 0; 
+  if(queued_msgs.firstSequenceNumber() == next_expected) { 
+    for(; next_expected < queued_msgs.nextMissing(); ++next_expected) { 
+      auto next_write = incoming_md_queue->getNextToWrite(); 
+      *next_write = queued_msgs.at(next_expected); 
+      incoming_md_queue->updateWriteIndex(); 
+      ++num_incrementals; 
+    }
+    queued_msgs.advanceTo(next_expected); 
+  }
+  if(!queued_msgs.empty()) { 
+    return; 
+  }
+  logger.log("%:% %() % Recovered ticker:% with % queued incrementals, next ticker seq:%.\n", 
+    __FILE__, __LINE__, __FUNCTION__, 
+    Common::getCurrentTimeStr(&time_str), tickerIdToString(ticker_id), num_incrementals, next_expected); 
+  ticker_in_recovery[ticker_id] = false; 
+  ticker_needs_snapshot[ticker_id] = false; 
+ }
+};
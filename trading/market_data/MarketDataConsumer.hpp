@@ -1,20 +1,44 @@
 #pragma once 
 
 #include <functional> 
-#include <map> 
+#include <memory> 
 
 #include "common/ThreadUtil.hpp"
 #include "common/LockFreeQueue.hpp"
 #include "common/Macros.hpp"
 #include "common/McastSocket.hpp"
+#include "common/SequenceRing.hpp"
+#include "common/TCPSocket.hpp"
 #include "exchange/market_data/MarketUpdate.hpp"
+#include "exchange/market_data/MarketDataChannel.hpp"
+#include "exchange/market_data/MDPCodec.hpp"
+#include "exchange/market_data/MDPReplay.hpp"
 
 namespace Trading { 
+ // Time to wait for a gap fill from the replay server before recovering from a snapshot instead 
+ constexpr Nanos MARKET_DATA_REPLAY_TIMEOUT = 100 * Common::NANOS_TO_MILLIS; 
+ // Replay socket buffers, a request goes out at a time and a response is at most a few dozen KB 
+ constexpr size_t MARKET_DATA_REPLAY_SEND_BUFFER_SIZE = 4 * 1024; 
+ constexpr size_t MARKET_DATA_REPLAY_RECV_BUFFER_SIZE = 256 * 1024; 
+
+ // Replay requests waiting on a channel, a gap takes one per MDP_REPLAY_MAX_MESSAGES updates. Updates that do not fit 
+ // are left to a snapshot. 
+ constexpr size_t MARKET_DATA_MAX_REPLAY_GAPS = 64; 
+
+ // Messages of one snapshot and incrementals of a ticker queued behind a gap that recovery can hold, the most 
+ // recent incrementals are kept if more arrive 
+ constexpr size_t MARKET_DATA_SNAPSHOT_QUEUE_SIZE = 1024 * 1024; 
+ constexpr size_t MARKET_DATA_TICKER_QUEUE_SIZE = 64 * 1024; 
+
+ // Joins only the market data channels carrying the configured tickers. Recovery is tracked per ticker with the 
+ // ticker sequence numbers of the incremental stream. A gap on a channel is filled from that channel's replay 
+ // server while the tickers it did not touch keep updating live, only a ticker that cannot be repaired that way 
+ // waits for a snapshot, and only its book is rebuilt from it. 
  class MarketDataConsumer { 
   public: 
     MarketDataConsumer(Common::ClientID client_id, Exchange::MarketUpdateLFQueue *market_update_queue, const std::string &iface_, 
-                       const std::string &snapshot_ip_, int snapshot_port_, 
-                       const std::string &incremental_ip_, int incremental_port_); 
+                       const Exchange::MarketDataChannelConfigs &channels_, const std::vector<TickerID> &tickers, 
+                       const std::string &replay_ip_); 
     
     ~MarketDataConsumer(); 
     
@@ -29,8 +53,51 @@ namespace Trading {
     MarketDataConsumer &operator = (const MarketDataConsumer &&) = delete; 
     
   private:
-    // Track the sequence number on the incremental market data stream, used to detect drop-off packets
-    size_t next_expected_sequence_number = 1; 
+    // Streams of one joined market data channel and the state of its recovery 
+    struct MarketDataChannel { 
+      const Exchange::MarketDataChannelConfig config; 
+
+      // Track the sequence number on the incremental market data stream, used to detect drop-off packets
+      size_t next_expected_sequence_number = 1; 
+
+      // Track the packet sequence numbers on both streams to report lost packets, 0 until the first packet is seen
+      size_t next_incremental_packet_sequence_number = 0; 
+      size_t next_snapshot_packet_sequence_number = 0; 
+
+      // Multicast subscriber socket for the incremental and market data streams 
+      Common::McastSocket incremental_mcast_socket, snapshot_mcast_socket; 
+
+      // Connection to the replay server used to fill gaps on the incremental stream 
+      Common::TCPSocket replay_socket; 
+
+      // Joined to the snapshot multicast stream while some ticker of the channel needs a snapshot 
+      bool is_snapshot_subscribed = false; 
+
+      // Gaps on the incremental stream to fill from the replay server, the front one is outstanding while 
+      // is_replay_pending is set 
+      std::vector<Exchange::MDPReplayRequest> replay_requests; 
+      bool is_replay_pending = false; 
+      Nanos replay_request_time = 0; 
+
+      // Snapshot messages queued in order of snapshot sequence number 
+      Common::SequenceRing<Exchange::MDPMarketUpdate> snapshot_queued_msgs; 
+      // Snapshot sequence number of the SNAPSHOT_END in snapshot_queued_msgs, 0 until it arrives 
+      size_t snapshot_end_sequence_number = 0; 
+      // Snapshot sequence number of each ticker's CLEAR in snapshot_queued_msgs, 0 until it arrives 
+      std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> snapshot_clear_sequence_number{}; 
+
+      MarketDataChannel(const Exchange::MarketDataChannelConfig &config_, Logger &logger) : 
+        config(config_), 
+        incremental_mcast_socket(logger), 
+        snapshot_mcast_socket(logger), 
+        replay_socket(logger, MARKET_DATA_REPLAY_SEND_BUFFER_SIZE, MARKET_DATA_REPLAY_RECV_BUFFER_SIZE), 
+        snapshot_queued_msgs(MARKET_DATA_SNAPSHOT_QUEUE_SIZE) { 
+        replay_requests.reserve(MARKET_DATA_MAX_REPLAY_GAPS); 
+      }
+    }; 
+
+    // Next ticker sequence number to apply to each ticker's book 
+    std::array<size_t, MATCHING_ENGINE_MAX_TICKERS> next_expected_ticker_sequence_number; 
 
     Exchange::MarketUpdateLFQueue *incoming_md_queue = nullptr; 
     
@@ -39,38 +106,73 @@ namespace Trading {
     std::string time_str; 
     Logger logger; 
 
-    // Multicast subscriber socket for the incremental and market data streams 
-    Common::McastSocket incremental_mcast_socket, snapshot_mcast_socket; 
-    
-    // Tracks if we are currently in the process of recovering / synchronizing with the snapshot of market data stream 
-    bool in_recovery_mode = false;
-
-    // Information for the snapshot multicast stream 
+    // Information for the market data streams 
     const std::string iface;
+    const std::string replay_ip; 
+
+    // Joined channels and the channel carrying each ticker, nullptr for tickers on channels not joined 
+    std::vector<std::unique_ptr<MarketDataChannel>> channels; 
+    std::array<MarketDataChannel*, MATCHING_ENGINE_MAX_TICKERS> ticker_channel{}; 
     
-    const std::string snapshot_ip; 
-    const int snapshot_port; 
-    const std::string incremental_ip; 
-    const int incremental_port;
-     
-    // Containers to queue up market data updates from the snapshot and incremental channels in order of increasing sequence numbers 
-    typedef std::map<size_t, Exchange::MatchingEngineMarketUpdate>QueuedMarketUpdates; 
-    QueuedMarketUpdates snapshot_queued_msgs, incremental_queued_msgs;
+    // Tickers missing updates, their incrementals are queued until the gap is filled 
+    std::array<bool, MATCHING_ENGINE_MAX_TICKERS> ticker_in_recovery{}; 
+    // Tickers in recovery that no queued replay can repair, they are rebuilt from the next snapshot 
+    std::array<bool, MATCHING_ENGINE_MAX_TICKERS> ticker_needs_snapshot{}; 
+
+    // Incrementals of each ticker in recovery queued in order of ticker sequence number 
+    typedef Common::SequenceRing<Exchange::MatchingEngineMarketUpdate> QueuedMarketUpdates; 
+    std::vector<std::unique_ptr<QueuedMarketUpdates>> ticker_queued_msgs; 
     
 
     // Main loop for this thread -> reads and processes incoming messages from multicast
     auto run() noexcept -> void; 
 
     // Process a market data update, consumer needs to use the socket parameter to find which stream the data came from
-    auto recvCallback(McastSocket *socket) noexcept -> void; 
+    auto recvCallback(MarketDataChannel &channel, McastSocket *socket) noexcept -> void; 
+
+    // Report packets lost on a stream based on the packet header 
+    auto checkPacketSequence(MarketDataChannel &channel, bool is_snapshot, const Exchange::MDPPacketHeader *header) noexcept -> void; 
+
+    // Apply a single update from either stream, queueing a replay on a sequence gap 
+    auto processMarketUpdate(MarketDataChannel &channel, bool is_snapshot, const Exchange::MDPMarketUpdate *request) noexcept -> void; 
+
+    // Apply an incremental to its ticker's book in ticker sequence order, entering recovery for that ticker on a gap 
+    auto applyTickerUpdate(MarketDataChannel &channel, size_t ticker_sequence_number, 
+                           const Exchange::MatchingEngineMarketUpdate &update) noexcept -> void; 
+
+    // Apply the contiguous incrementals queued for a ticker and leave recovery if none are left behind a gap 
+    auto resumeTicker(TickerID ticker_id) noexcept -> void; 
+
+    // Queue up a snapshot message 
+    auto queueMessage(MarketDataChannel &channel, const Exchange::MDPMarketUpdate *request) -> void; 
 
-    // Queued up the messages 
-    auto queueMessage(bool is_snapshot, const Exchange::MDPMarketUpdate *updates) -> void; 
+    // Queue a gap fill for incremental updates [first_sequence_number, last_sequence_number], split into requests 
+    // of at most MDP_REPLAY_MAX_MESSAGES. Gaps the replay server cannot serve are left to the snapshot stream. 
+    auto queueReplay(MarketDataChannel &channel, size_t first_sequence_number, size_t last_sequence_number) noexcept -> void; 
+
+    // Send the replay request at the front of the queue 
+    auto requestReplay(MarketDataChannel &channel) noexcept -> void; 
+
+    // Apply replayed updates from the replay server 
+    auto replayCallback(MarketDataChannel &channel, TCPSocket *socket, Nanos rx_time) noexcept -> void; 
+
+    // Done with the outstanding gap fill, move on to the next one or recover the tickers it did not repair 
+    // from a snapshot. All queued gaps are dropped if the replay server is unusable. 
+    auto finishReplay(MarketDataChannel &channel, bool drop_all) noexcept -> void; 
+
+    // Mark every ticker of the channel in recovery as needing a snapshot once no replays are left to repair it 
+    auto checkTickersNeedingSnapshot(MarketDataChannel &channel) noexcept -> void; 
 
     // Start the process of snapshot/synchronization by subscribing to the snapshot multicast stream 
-    auto startSnapshotSync() noexcept -> void; 
+    auto startSnapshotSync(MarketDataChannel &channel) noexcept -> void; 
+
+    // Drop a partly received snapshot and wait for the next SNAPSHOT_START 
+    auto resetSnapshotQueue(MarketDataChannel &channel) noexcept -> void; 
+
+    // Check if a complete snapshot is queued and rebuild the tickers that need it 
+    auto checkSnapshotSync(MarketDataChannel &channel) noexcept -> void; 
 
-    // Check if a recovery/synchronization is possible from the queued up market data updates from the snapshot and incremental stream 
-    auto checkSnapshotSync() noexcept -> void; 
+    // Replace a ticker's book with its part of the queued snapshot, returns false if the snapshot is older than the book 
+    auto applyTickerSnapshot(MarketDataChannel &channel, TickerID ticker_id) noexcept -> bool; 
  }; 
-}
\ No newline at end of file
+}
@@ -32,6 +32,9 @@ namespace Trading {
   ASSERT(tcp_socket.connect(ip, iface, port, false) >= 0, 
    "Unable to connect to ip: " + ip + " port :" + std::to_string(port) + " on iface : " + iface + " error: " + std::string(std::strerror(errno))
   ); 
+  // the session carries this client id from here on, no later message repeats it 
+  char frame[sizeof(Exchange::OrderEntryLogon)]; 
+  ASSERT(tcp_socket.send(frame, Exchange::encodeLogon(client_id, frame)), "Unable to queue logon for client: " + std::to_string(client_id)); 
   ASSERT(Common::createAndStartThread(-1, "Trading/OrderGateway", 
     [this]() { run(); }) != nullptr, "Failed to start order gateway thread."
   ); 
@@ -60,8 +63,37 @@ namespace Trading {
         next_outgoing_sequence_number, 
         client_request->toString()
       );
-      tcp_socket.send(&next_outgoing_sequence_number, sizeof(next_outgoing_sequence_number)); 
-      tcp_socket.send(client_request, sizeof(Exchange::MatchingEngineClientRequest)); 
+      char frame[Exchange::ORDER_ENTRY_MAX_MESSAGE_SIZE]; 
+      const auto frame_size = Exchange::encodeClientRequest(static_cast<uint32_t>(next_outgoing_sequence_number), *client_request, frame); 
+      if(UNLIKELY(!frame_size)) { 
+        // the exchange never sees the request, answer it here so the order does not stay pending 
+        const Exchange::MatchingEngineClientResponse reject { 
+          client_request->type == Exchange::ClientRequestType::CANCEL ? Exchange::ClientResponseType::CANCEL_REJECTED 
+                                                                       : Exchange::ClientResponseType::REJECTED, 
+          client_request->client_id, 
+          client_request->ticker_id, 
+          client_request->order_id, 
+          Common::ORDER_ID_INVALID, 
+          client_request->side, 
+          client_request->price, 
+          Common::QUANTITY_INVALID, 
+          Common::QUANTITY_INVALID 
+        }; 
+        logger.log("%:% %() % ERROR Cannot encode %, rejecting with %\n", 
+          __FILE__, __LINE__, __FUNCTION__,
+          Common::getCurrentTimeStr(&time_str), client_request->toString(), reject.toString()); 
+        *(incoming_response->getNextToWrite()) = reject; 
+        incoming_response->updateWriteIndex(); 
+        outgoing_request->updateReadIndex(); 
+        continue; 
+      }
+      if(UNLIKELY(!tcp_socket.send(frame, frame_size))) { 
+        // back-pressure: the request stays queued until the exchange drains the socket 
+        logger.log("%:% %() % Send buffer full, holding % requests\n", 
+          __FILE__, __LINE__, __FUNCTION__,
+          Common::getCurrentTimeStr(&time_str), outgoing_request->size()); 
+        break; 
+      }
       outgoing_request->updateReadIndex(); 
       next_outgoing_sequence_number++; 
     }
@@ -73,47 +105,53 @@ namespace Trading {
      __FILE__, __LINE__, __FUNCTION__, 
      Common::getCurrentTimeStr(&time_str), 
      socket->socket_fd, 
-     socket->next_recv_valid_index,
+     socket->next_recv_valid_index - socket->next_recv_read_index,
      rx_time
     ); 
-    if(socket->next_recv_valid_index >= sizeof(Exchange::OrderManagementClientResponse)) { 
-      size_t index = 0; 
-      for(; index + sizeof(Exchange::OrderManagementClientResponse) <= socket->next_recv_valid_index; 
-            index += sizeof(Exchange::OrderManagementClientResponse)) { 
-        auto response = reinterpret_cast<Exchange::OrderManagementClientResponse*>(
-         socket->recv_buffer.data() + index    
+    size_t index = socket->next_recv_read_index; 
+    bool is_corrupt = false; 
+    for(size_t frame_size; (frame_size = Exchange::orderEntryFrameSize(socket->recv_buffer.data() + index, 
+                                                                       socket->next_recv_valid_index - index, is_corrupt)); 
+        index += frame_size) { 
+      uint32_t sequence_number = 0; 
+      Exchange::MatchingEngineClientResponse response; 
+      if(!Exchange::decodeClientResponse(socket->recv_buffer.data() + index, client_id, sequence_number, response)) { 
+        logger.log("%:% %() % ERROR Unexpected %\n", 
+          __FILE__, __LINE__, __FUNCTION__,
+          Common::getCurrentTimeStr(&time_str), 
+          reinterpret_cast<const Exchange::OrderEntryHeader *>(socket->recv_buffer.data() + index)->toString()
         ); 
-        logger.log("%:% %() % Received %\n", 
-         __FILE__, __LINE__, __FUNCTION__, 
-         Common::getCurrentTimeStr(&time_str), 
-         response->toString()
+        continue; 
+      }
+      logger.log("%:% %() % Received seq:% %\n", 
+       __FILE__, __LINE__, __FUNCTION__, 
+       Common::getCurrentTimeStr(&time_str), 
+       sequence_number, 
+       response.toString()
+      );
+      if(sequence_number != static_cast<uint32_t>(next_expected_sequence_number)) { 
+        logger.log("%:% %() % ERROR Incorrect sequence number. ClientId:%. SeqNum expected:% received:%.\n", 
+          __FILE__, __LINE__, __FUNCTION__,
+          Common::getCurrentTimeStr(&time_str), 
+          client_id, 
+          next_expected_sequence_number, 
+          sequence_number
         );
-        if(response->me_client_response.client_id != client_id) { // This should never happens
-          logger.log("%:% %() % ERROR Incorrect client id. ClientId expected:% received:%.\n", 
-                    __FILE__, __LINE__, __FUNCTION__,
-                    Common::getCurrentTimeStr(&time_str), 
-                    client_id, 
-                    response->me_client_response.client_id
-          );
-          continue;  
-        }
-        if(response->sequence_number != next_expected_sequence_number) { 
-          logger.log("%:% %() % ERROR Incorrect sequence number. ClientId:%. SeqNum expected:% received:%.\n", 
-            __FILE__, __LINE__, __FUNCTION__,
-            Common::getCurrentTimeStr(&time_str), 
-            client_id, 
-            next_expected_sequence_number, 
-            response->sequence_number
-          );
-          continue;   
-        }
-        ++next_expected_sequence_number; 
-        auto next_write = incoming_response->getNextToWrite();
-        *next_write = response->me_client_response; 
-        incoming_response->updateWriteIndex();  
+        continue;   
       }
-      memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + index, socket->next_recv_valid_index - index); 
-      socket->next_recv_valid_index -= index; 
+      ++next_expected_sequence_number; 
+      auto next_write = incoming_response->getNextToWrite();
+      *next_write = response; 
+      incoming_response->updateWriteIndex();  
+    }
+    if(UNLIKELY(is_corrupt)) { 
+      logger.log("%:% %() % ERROR Dropping % bytes after a corrupt frame header.\n", 
+        __FILE__, __LINE__, __FUNCTION__,
+        Common::getCurrentTimeStr(&time_str), 
+        socket->next_recv_valid_index - index
+      );
+      index = socket->next_recv_valid_index; 
     }
+    socket->next_recv_read_index = index; 
  }
 }
\ No newline at end of file
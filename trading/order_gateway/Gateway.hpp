@@ -6,6 +6,7 @@
 #include "common/TCPServer.hpp"
 #include "exchange/order_server/ClientRequest.hpp"
 #include "exchange/order_server/ClientResponse.hpp"
+#include "exchange/order_server/OrderEntryProtocol.hpp"
 
 namespace Trading { 
  class OrderGateway { 
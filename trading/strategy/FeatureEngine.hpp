@@ -13,19 +13,20 @@ namespace Trading {
     FeatureEngine(Common::Logger *logger_) : logger(logger_) { }
 
     auto onOrderBookUpdate(TickerID ticker_id, Price price, Side side, MarketOrderBook *book) noexcept -> void { 
-      const auto bbo = book->getBBO(); 
-      if(LIKELY(bbo->best_bid_price != PRICE_INVALID && bbo->best_ask_price != PRICE_INVALID)) { 
-        market_price = (static_cast<double>(bbo->best_bid_price * bbo->best_ask_quantity) + 
-                        static_cast<double>(bbo->best_ask_price * bbo->best_bid_quantity)) / 
-                        static_cast<double>(bbo->best_ask_quantity + bbo->best_bid_quantity); 
+      // the book keeps both up to date, a one sided book leaves the last values 
+      const auto depth = book->getDepth(); 
+      if(LIKELY(depth->numBids() && depth->numAsks())) { 
+        market_price = depth->microprice; 
+        book_imbalance = depth->imbalance; 
       }
-      logger->log("%:% %() % ticker:% price:% side:% mkt-price:% agg-trade-ratio:%\n",
+      logger->log("%:% %() % ticker:% price:% side:% mkt-price:% book-imbalance:% agg-trade-ratio:%\n",
         __FILE__, __LINE__, __FUNCTION__,
         Common::getCurrentTimeStr(&time_str),
         ticker_id, 
         Common::priceToString(price).c_str(),
         Common::sideToString(side).c_str(),
         market_price, 
+        book_imbalance, 
         agg_trade_qty_ratio
       );
     }
@@ -53,6 +54,10 @@ namespace Trading {
       return agg_trade_qty_ratio; 
     }
 
+    auto getBookImbalance() const noexcept { 
+      return book_imbalance; 
+    }
+
 
     FeatureEngine() = delete;
 
@@ -69,5 +74,7 @@ namespace Trading {
     Common::Logger *logger = nullptr; 
     double market_price        = FEATURE_INVALID; 
     double agg_trade_qty_ratio = FEATURE_INVALID; 
+    // Quantity imbalance over the book's top levels, see BookDepth 
+    double book_imbalance      = FEATURE_INVALID; 
  }; 
 }
\ No newline at end of file
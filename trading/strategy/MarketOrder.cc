@@ -23,6 +23,8 @@ namespace Trading {
          << "side:" << sideToString(side) << " "
          << "price:" << priceToString(price) << " "
          << "first_mkt_order:" << (first_market_order ? first_market_order->toString() : "null") << " "
+         << "qty:" << quantityToString(quantity) << " "
+         << "orders:" << num_orders << " "
          << "prev:" << priceToString(prev_entry ? prev_entry->price : PRICE_INVALID) << " "
          << "next:" << priceToString(next_entry ? next_entry->price : PRICE_INVALID) << "]";
       return ss.str();
@@ -3,6 +3,7 @@
 #include <array> 
 #include <sstream> 
 #include "common/Types.hpp"
+#include "common/IdHashMap.hpp"
 
 using namespace  Common; 
 
@@ -30,12 +31,16 @@ namespace Trading {
     
     auto toString() const -> std::string; 
   }; 
-  typedef std::array<MarketOrder *, MATCHING_ENGINE_MAX_ORDER_IDS> OrderHashMap; 
+  // Keyed by the exchange market order id, which grows without bound for the life of a book 
+  typedef IdHashMap<MarketOrder> OrderHashMap; 
 
   struct MarketOrdersAtPrice { 
     Side side = Side::INVALID; 
     Price price = PRICE_INVALID; 
     MarketOrder *first_market_order = nullptr; 
+    // Total quantity and number of orders at the level, kept up to date on every ADD, MODIFY and CANCEL 
+    Quantity quantity = 0; 
+    uint32_t num_orders = 0; 
     MarketOrdersAtPrice *prev_entry = nullptr; 
     MarketOrdersAtPrice *next_entry = nullptr; 
 
@@ -4,9 +4,13 @@
 namespace Trading { 
  MarketOrderBook::MarketOrderBook(TickerID ticker_id_, Logger *logger_) : 
  ticker_id(ticker_id_), 
+ oid_to_order(MARKET_ORDER_BOOK_INITIAL_ORDER_SLOTS), 
  orders_at_price_pool(MATCHING_ENGINE_MAX_PRICE_LEVELS), 
  order_pool(MATCHING_ENGINE_MAX_ORDER_IDS),
- logger(logger_) { }
+ logger(logger_) { 
+  depth.ticker_id = ticker_id; 
+  depth_view.store(depth); 
+ }
 
  MarketOrderBook::~MarketOrderBook() { 
   logger->log("%:% %() % OrderBook\n%\n", 
@@ -16,16 +20,20 @@ namespace Trading {
   );
   trade_engine = nullptr; 
   bids_by_price = asks_by_price = nullptr; 
-  oid_to_order.fill(nullptr); 
+  oid_to_order.clear(); 
  }
 
  auto MarketOrderBook::onMarketUpdate(const Exchange::MatchingEngineMarketUpdate *market_update) noexcept -> void { 
-  const auto bid_updated = (bids_by_price && market_update->side == Side::BUY && market_update->price >= bids_by_price->price); 
-  const auto ask_updated = (asks_by_price && market_update->side == Side::SELL && market_update->price <= asks_by_price->price); 
+  // an update on an empty side sets its best level and a CLEAR empties both 
+  const auto is_clear = (market_update->type == Exchange::MarketUpdateType::CLEAR); 
+  const auto bid_updated = is_clear || (market_update->side == Side::BUY && (!bids_by_price || market_update->price >= bids_by_price->price)); 
+  const auto ask_updated = is_clear || (market_update->side == Side::SELL && (!asks_by_price || market_update->price <= asks_by_price->price)); 
+  const auto bid_depth_updated = is_clear || (market_update->side == Side::BUY && isInDepthView(Side::BUY, market_update->price)); 
+  const auto ask_depth_updated = is_clear || (market_update->side == Side::SELL && isInDepthView(Side::SELL, market_update->price)); 
   switch(market_update->type) { 
     case Exchange::MarketUpdateType::ADD : { 
       ASSERT(
-        oid_to_order.at(market_update->order_id) == nullptr, 
+        oid_to_order.find(market_update->order_id) == nullptr, 
         "Add Market Order received for existing order id : " + std::to_string(market_update->order_id)
       ); 
       auto order = order_pool.allocate(
@@ -41,16 +49,17 @@ namespace Trading {
     }
     break; 
     case Exchange::MarketUpdateType::MODIFY : { 
-      auto order = oid_to_order.at(market_update->order_id); 
+      auto order = oid_to_order.find(market_update->order_id); 
       ASSERT(order != nullptr, 
        "Modify Market Order received for non-existing order id : " + std::to_string(market_update->order_id)
       ); 
+      getOrdersAtPrice(order->price)->quantity += market_update->quantity - order->quantity; 
       order->quantity = market_update->quantity; 
     }
     break; 
 
     case Exchange::MarketUpdateType::CANCEL : { 
-      auto order = oid_to_order.at(market_update->order_id); 
+      auto order = oid_to_order.find(market_update->order_id); 
       ASSERT(order != nullptr, 
        "Cancel Market Order received for non-existing order id : " + std::to_string(market_update->order_id) 
       ); 
@@ -65,24 +74,20 @@ namespace Trading {
     break; 
 
     case Exchange::MarketUpdateType::CLEAR : { 
-      for(auto &order : oid_to_order) { 
-        if(order) { 
-          order_pool.deallocate(order); 
-        }
-      }
-      oid_to_order.fill(nullptr); 
-      if(bids_by_price) { 
-        for(auto bid = bids_by_price->next_entry; bid != bids_by_price; bid = bid->next_entry) { 
-          orders_at_price_pool.deallocate(bid);   
+      // only the live levels and their orders are visited, then both pools are freed at once 
+      for(auto best_orders_by_price : {bids_by_price, asks_by_price}) { 
+        for(auto level = best_orders_by_price; level; 
+            level = (level->next_entry == best_orders_by_price ? nullptr : level->next_entry)) { 
+          auto order = level->first_market_order; 
+          do { 
+            oid_to_order.erase(order->order_id); 
+            order = order->next_order; 
+          } while(order != level->first_market_order); 
+          price_orders_at_price.at(priceToIndex(level->price)) = nullptr; 
         }
-        orders_at_price_pool.deallocate(bids_by_price); 
-      }
-      if(asks_by_price) { 
-        for(auto ask = asks_by_price->next_entry; ask != asks_by_price; ask = ask->next_entry) { 
-          orders_at_price_pool.deallocate(ask); 
-        }
-        orders_at_price_pool.deallocate(asks_by_price); 
       }
+      order_pool.reset(); 
+      orders_at_price_pool.reset(); 
       bids_by_price = asks_by_price = nullptr; 
     }
     break; 
@@ -90,9 +95,16 @@ namespace Trading {
     case Exchange::MarketUpdateType::INVALID : 
     case Exchange::MarketUpdateType::SNAPSHOT_START : 
     case Exchange::MarketUpdateType::SNAPSHOT_END : 
+    case Exchange::MarketUpdateType::PRICE_LEVEL : 
       break;
   }
   updateBBO(bid_updated, ask_updated); 
+  if(bid_depth_updated) { 
+    publishDepth(Side::BUY); 
+  }
+  if(ask_depth_updated) { 
+    publishDepth(Side::SELL); 
+  }
   logger->log("%:% %() % % %", 
     __FILE__, __LINE__, __FUNCTION__,
     Common::getCurrentTimeStr(&time_str), 
@@ -107,11 +119,7 @@ namespace Trading {
   if(bid_updated) { 
     if(bids_by_price) { 
      bbo.best_bid_price = bids_by_price->price; 
-     bbo.best_bid_quantity = bids_by_price->first_market_order->quantity; 
-     for(auto order = bids_by_price->first_market_order->next_order; 
-              order != bids_by_price->first_market_order; order = order->next_order) { 
-      bbo.best_bid_quantity += order->quantity; 
-     }
+     bbo.best_bid_quantity = bids_by_price->quantity; 
     } else { 
       bbo.best_bid_price    = PRICE_INVALID; 
       bbo.best_bid_quantity = QUANTITY_INVALID;   
@@ -120,11 +128,7 @@ namespace Trading {
   if(ask_updated) { 
     if(asks_by_price) { 
      bbo.best_ask_price = asks_by_price->price; 
-     bbo.best_ask_quantity = asks_by_price->first_market_order->quantity; 
-     for(auto order = asks_by_price->first_market_order->next_order; 
-              order != asks_by_price->first_market_order; order = order->next_order) { 
-      bbo.best_ask_quantity += order->quantity; 
-     }
+     bbo.best_ask_quantity = asks_by_price->quantity; 
     } else { 
       bbo.best_ask_price    = PRICE_INVALID; 
       bbo.best_ask_quantity = QUANTITY_INVALID;   
@@ -132,6 +136,28 @@ namespace Trading {
   }
  }
 
+ auto MarketOrderBook::isInDepthView(Side side, Price price) const noexcept -> bool { 
+  const auto num_levels = depth.num_levels[sideToIndex(side)]; 
+  if(num_levels < BOOK_DEPTH_LEVELS) { 
+    return true; 
+  }
+  const auto last_price = depth.levels[sideToIndex(side)][num_levels - 1].price; 
+  return (side == Side::BUY ? price >= last_price : price <= last_price); 
+ }
+
+ auto MarketOrderBook::publishDepth(Side side) noexcept -> void { 
+  const auto best_orders_by_price = (side == Side::BUY ? bids_by_price : asks_by_price); 
+  auto &levels = depth.levels[sideToIndex(side)]; 
+  uint32_t num_levels = 0; 
+  for(auto level = best_orders_by_price; level && num_levels < BOOK_DEPTH_LEVELS; 
+      level = (level->next_entry == best_orders_by_price ? nullptr : level->next_entry), ++num_levels) { 
+    levels[num_levels] = {level->price, level->quantity, level->num_orders}; 
+  }
+  depth.num_levels[sideToIndex(side)] = num_levels; 
+  depth.updateDerived(); 
+  depth_view.store(depth); 
+ }
+
  auto MarketOrderBook::toString(bool detailed, bool validity_check) const -> std::string { 
   std::stringstream ss; 
   std::string curr_time_str; 
@@ -171,6 +197,9 @@ namespace Trading {
    ss_ << std::endl; 
   
    if(sanity_check) { 
+    if(quantity != itr->quantity || num_orders != itr->num_orders) { 
+      FATAL("Level aggregates out of date qty:" + quantityToString(quantity) + " orders:" + std::to_string(num_orders) + " itr : " + itr->toString()); 
+    }
     if((side == Side::SELL && last_price >= itr->price) || (side == Side::BUY && last_price <= itr->price)) { 
      FATAL("Bids/Asks not sorted by descending/ascending prices last : " + priceToString(last_price) + "itr : " + itr->toString());  
     }
@@ -193,7 +222,7 @@ namespace Trading {
   
   {
     auto bid_itr = bids_by_price; 
-    auto last_bid_price = std::numeric_limits<Price>::min(); 
+    auto last_bid_price = std::numeric_limits<Price>::max(); 
     for(size_t count = 0; bid_itr; count++) { 
      ss << "BIDS L : " << count << " => "; 
      auto next_bid_itr = (bid_itr->next_entry == bids_by_price ? nullptr : bid_itr->next_entry); 
@@ -3,10 +3,14 @@
 #include "common/Types.hpp"
 #include "common/Mempool.hpp"
 #include "common/Logging.hpp"
+#include "common/BookDepth.hpp"
 #include "MarketOrder.hpp"
 #include "exchange/market_data/MarketUpdate.hpp"
 
 namespace Trading { 
+ // Initial slots of the order id index, enough for half as many live orders before it grows 
+ constexpr size_t MARKET_ORDER_BOOK_INITIAL_ORDER_SLOTS = 16 * 1024; 
+
  class TradeEngine; 
 
  class MarketOrderBook final { 
@@ -26,6 +30,16 @@ namespace Trading {
     return &bbo; 
    }
 
+   // Best levels of the book with microprice and imbalance, kept up to date on every update 
+   auto getDepth() const noexcept -> const BookDepth* { 
+    return &depth; 
+   }
+
+   // Copy of getDepth() for risk checks, dashboards or strategies on other threads 
+   auto getDepthView() const noexcept -> const BookDepthView* { 
+    return &depth_view; 
+   }
+
    auto toString(bool detailed, bool validity_check) const -> std::string; 
 
    MarketOrderBook() = delete;
@@ -51,6 +65,8 @@ namespace Trading {
 
    MemPool<MarketOrder>order_pool; 
    BBO bbo; 
+   BookDepth depth; 
+   BookDepthView depth_view; 
    std::string time_str; 
    Logger *logger = nullptr; 
 
@@ -63,6 +79,12 @@ namespace Trading {
     return price_orders_at_price.at(priceToIndex(price));
   }
 
+  // True if a change at price shows in depth, call before applying the change 
+  auto isInDepthView(Side side, Price price) const noexcept -> bool; 
+
+  // Rewrite the side of depth from the book and publish it to depth_view 
+  auto publishDepth(Side side) noexcept -> void; 
+
   auto removeOrderAtPrice(Side side, Price price) noexcept {
     const auto best_orders_by_price =
         (side == Side::BUY ? bids_by_price : asks_by_price);
@@ -84,6 +106,8 @@ namespace Trading {
 
   auto removeOrder(MarketOrder* order) noexcept {
     auto order_at_price = getOrdersAtPrice(order->price);
+    order_at_price->quantity -= order->quantity;
+    --order_at_price->num_orders;
     if (order->prev_order == order) {  // only one element in the list
       removeOrderAtPrice(order->side, order->price);
     } else {
@@ -96,7 +120,7 @@ namespace Trading {
       }
       order->prev_order = order->next_order = nullptr;
     }
-    oid_to_order.at(order->order_id) = nullptr; 
+    oid_to_order.erase(order->order_id); 
     order_pool.deallocate(order);
   }
 
@@ -163,12 +187,12 @@ namespace Trading {
   }
 
   auto addOrder(MarketOrder* order) noexcept {
-    const auto orders_at_price = getOrdersAtPrice(order->price);
+    auto orders_at_price = getOrdersAtPrice(order->price);
     if (!orders_at_price) {
       order->next_order = order->prev_order = order;
-      auto new_orders_at_price = orders_at_price_pool.allocate(
+      orders_at_price = orders_at_price_pool.allocate(
           order->side, order->price, order, nullptr, nullptr);
-      addOrderAtPrice(new_orders_at_price);
+      addOrderAtPrice(orders_at_price);
     } else {
       auto first_order = orders_at_price->first_market_order;
       first_order->prev_order->next_order = order;
@@ -176,7 +200,9 @@ namespace Trading {
       order->next_order = first_order;
       first_order->prev_order = order;
     }
-    oid_to_order.at(order->order_id) = order; 
+    orders_at_price->quantity += order->quantity;
+    ++orders_at_price->num_orders;
+    oid_to_order.insert(order->order_id, order); 
   }
  }; 
  
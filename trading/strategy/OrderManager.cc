@@ -93,6 +93,15 @@ namespace Trading {
                 Common::getCurrentTimeStr(&time_str),
                 client_response->toString().c_str()
     );
+    if(UNLIKELY(client_response->ticker_id >= ticker_side_orders.size() || 
+                (client_response->side != Side::BUY && client_response->side != Side::SELL))) { 
+      logger->log("%:% %() % Ignoring response for unknown ticker/side %\n", 
+                  __FILE__, __LINE__, __FUNCTION__, 
+                  Common::getCurrentTimeStr(&time_str),
+                  client_response->toString().c_str()
+      );
+      return; 
+    }
     auto order = &(ticker_side_orders.at(client_response->ticker_id).at(sideToIndex(client_response->side))); 
     logger->log("%:% %() % %\n", 
       __FILE__, __LINE__, __FUNCTION__, 
@@ -119,6 +128,16 @@ namespace Trading {
       }
       break; 
 
+      case Exchange::ClientResponseType::REJECTED : { 
+        order->order_state = OMOrderState::DEAD;  
+      }
+      break; 
+
+      case Exchange::ClientResponseType::DECREMENTED : { 
+        order->quantity = client_response->leaves_quantity; 
+      }
+      break; 
+
       case Exchange::ClientResponseType::CANCEL_REJECTED :
       case Exchange::ClientResponseType::INVALID :  {
 
@@ -77,10 +77,13 @@ int main(int argc, char **argv) {
 
   // Initialize market data consumer 
   const std::string market_data_iface = "lo";
-  const std::string snapshot_ip = "233.252.14.1";
-  const int snapshot_port = 20000;
-  const std::string incremental_ip = "233.252.14.3";
-  const int incremental_port = 20001;
+  const auto market_data_channels = Exchange::defaultMarketDataChannels();
+  const std::string replay_ip = "127.0.0.1";
+  // only the channels of the configured tickers are joined, all of them if no ticker is configured
+  std::vector<Common::TickerID> market_data_tickers;
+  for(size_t ticker_id = 0; ticker_id < (next_ticker_id ? next_ticker_id : Common::MATCHING_ENGINE_MAX_TICKERS); ticker_id++) {
+    market_data_tickers.push_back(static_cast<Common::TickerID>(ticker_id));
+  }
 
   logger->log("%:% %() % Starting Market Data Consumer...\n", 
     __FILE__, __LINE__, __FUNCTION__,
@@ -90,10 +93,9 @@ int main(int argc, char **argv) {
     client_id, 
     &market_updates,
     market_data_iface, 
-    snapshot_ip, 
-    snapshot_port,
-    incremental_ip, 
-    incremental_port
+    market_data_channels,
+    market_data_tickers,
+    replay_ip
   );
   market_data_consumer->start();
 